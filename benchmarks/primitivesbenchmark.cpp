@@ -0,0 +1,247 @@
+#include "client.h"
+#include "voucher.h"
+#include "vouchervalidator.h"
+#include "database.h"
+#include "timingwheel.h"
+#include "frame.h"
+
+#include <QtTest>
+#include <QSettings>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborArray>
+
+namespace shiftnet {
+
+// Primitif yang dijalankan untuk setiap pesan atau setiap menit per PC.
+// Hasil dalam format mesin: shiftnet-benchmarks -o hasil.xml,xml
+class PrimitivesBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void decodeMessage_data();
+    void decodeMessage();
+    void encodeFrame_data();
+    void encodeFrame();
+    void clientToMap();
+    void voucherDurationString_data();
+    void voucherDurationString();
+    void voucherValidatorIsValid_data();
+    void voucherValidatorIsValid();
+    void clientUpdateDuration_data();
+    void clientUpdateDuration();
+
+private:
+    enum {
+        VoucherCount = 1000
+    };
+
+    QTemporaryDir _dir;
+};
+
+}
+
+using namespace shiftnet;
+
+void PrimitivesBenchmark::initTestCase()
+{
+    QVERIFY(_dir.isValid());
+
+    QSettings settings(_dir.filePath("benchmark.ini"), QSettings::IniFormat);
+    settings.setValue("Databases/main.driver", "QSQLITE");
+    settings.setValue("Databases/main.schema", _dir.filePath("benchmark.db"));
+    Database::setup(settings);
+
+    // skema dibuat oleh Database::init untuk SQLite
+    QVERIFY(Database::init());
+
+    QSqlDatabase db = Database::connection();
+    QSqlQuery q(db);
+
+    const QDateTime expiration = QDateTime::currentDateTime().addDays(30);
+    QVERIFY(db.transaction());
+    for (int i = 1; i <= VoucherCount; i++) {
+        const QString code = QString("BENCH%1").arg(i, 5, 10, QChar('0'));
+
+        q.prepare("insert into shiftnet_voucher_transactions (id, code, duration, expirationDateTime) values (?, ?, ?, ?)");
+        q.addBindValue(i);
+        q.addBindValue(code);
+        q.addBindValue(120);
+        q.addBindValue(expiration);
+        QVERIFY(q.exec());
+
+        q.prepare("insert into shiftnet_active_vouchers (code, voucherId, remainingDuration) values (?, ?, ?)");
+        q.addBindValue(code);
+        q.addBindValue(i);
+        q.addBindValue(120);
+        QVERIFY(q.exec());
+    }
+    QVERIFY(db.commit());
+}
+
+void PrimitivesBenchmark::cleanupTestCase()
+{
+    Database::closeConnection();
+}
+
+void PrimitivesBenchmark::decodeMessage_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<QByteArray>("message");
+
+    const QVariantList login({ "client", "member-login", QVariantList({ "pelanggan01", "rahasia", "BENCH00001" }) });
+    QTest::newRow("json") << int(Frame::Json) << QJsonDocument(QJsonArray::fromVariantList(login)).toJson(QJsonDocument::Compact);
+    QTest::newRow("cbor") << int(Frame::Cbor) << QCborArray::fromVariantList(login).toCborValue().toCbor();
+}
+
+void PrimitivesBenchmark::decodeMessage()
+{
+    QFETCH(int, format);
+    QFETCH(QByteArray, message);
+
+    // pesan teks sampai di shard sebagai QString
+    const QString text = QString::fromUtf8(message);
+    QVariantList data;
+
+    if (format == Frame::Json) {
+        QBENCHMARK {
+            Frame::decode(text.toUtf8(), Frame::Json, &data);
+        }
+    }
+    else {
+        QBENCHMARK {
+            Frame::decode(message, Frame::Cbor, &data);
+        }
+    }
+
+    QCOMPARE(data.size(), 3);
+}
+
+void PrimitivesBenchmark::encodeFrame_data()
+{
+    QTest::addColumn<int>("format");
+
+    QTest::newRow("json") << int(Frame::Json);
+    QTest::newRow("cbor") << int(Frame::Cbor);
+}
+
+void PrimitivesBenchmark::encodeFrame()
+{
+    QFETCH(int, format);
+
+    TimingWheel timingWheel;
+    Client client(&timingWheel);
+    client.setId(7);
+    client.startGuestSession("tamu", Voucher("BENCH00001", 120, 1));
+    const QVariantMap message = client.toMap();
+
+    // sendTo membuat frame baru setiap kali, encode terjadi sekali per format
+    QBENCHMARK {
+        const Frame frame("client-session-start", message);
+        frame.data(Frame::Format(format));
+    }
+}
+
+void PrimitivesBenchmark::clientToMap()
+{
+    TimingWheel timingWheel;
+    Client client(&timingWheel);
+    client.setId(7);
+    client.startGuestSession("tamu", Voucher("BENCH00001", 120, 1));
+
+    QVariantMap map;
+    QBENCHMARK {
+        map = client.toMap();
+    }
+
+    QCOMPARE(map.value("id").toInt(), 7);
+}
+
+void PrimitivesBenchmark::voucherDurationString_data()
+{
+    QTest::addColumn<int>("duration");
+
+    QTest::newRow("minutes") << 45;
+    QTest::newRow("hours") << 1234;
+}
+
+void PrimitivesBenchmark::voucherDurationString()
+{
+    QFETCH(int, duration);
+
+    const Voucher voucher("BENCH00001", duration);
+    QString text;
+    QBENCHMARK {
+        text = voucher.durationString();
+    }
+
+    QVERIFY(!text.isEmpty());
+}
+
+void PrimitivesBenchmark::voucherValidatorIsValid_data()
+{
+    QTest::addColumn<QString>("code");
+    QTest::addColumn<bool>("valid");
+
+    QTest::newRow("found") << QString("BENCH00500") << true;
+    QTest::newRow("unknown") << QString("TIDAKADA") << false;
+}
+
+void PrimitivesBenchmark::voucherValidatorIsValid()
+{
+    QFETCH(QString, code);
+    QFETCH(bool, valid);
+
+    bool result = false;
+    QBENCHMARK {
+        VoucherValidator validator;
+        result = validator.isValid(code, false);
+    }
+
+    QCOMPARE(result, valid);
+}
+
+void PrimitivesBenchmark::clientUpdateDuration_data()
+{
+    QTest::addColumn<int>("seatCount");
+
+    QTest::newRow("50 seats") << 50;
+    QTest::newRow("500 seats") << 500;
+}
+
+void PrimitivesBenchmark::clientUpdateDuration()
+{
+    QFETCH(int, seatCount);
+
+    TimingWheel timingWheel;
+    QList<Client*> clients;
+    for (int i = 0; i < seatCount; i++) {
+        Client* client = new Client(&timingWheel, this);
+        client->setId(i + 1);
+        // durasi cukup panjang supaya tidak ada sesi yang habis selama pengukuran
+        client->startGuestSession(QString("tamu%1").arg(i), Voucher(QString("BENCH%1").arg(i), 100000000, i + 1));
+        clients << client;
+    }
+
+    // setiap putaran memajukan satu menit, semua sesi di-update lewat timing wheel seperti di server
+    int fired = 0;
+    QBENCHMARK {
+        fired = timingWheel.advanceBy(60 * 1000 / timingWheel.resolution());
+    }
+
+    QCOMPARE(fired, seatCount);
+    QCOMPARE(clients.first()->state(), Client::Used);
+    qDeleteAll(clients);
+}
+
+QTEST_GUILESS_MAIN(PrimitivesBenchmark)
+
+#include "primitivesbenchmark.moc"
@@ -0,0 +1,25 @@
+# Jalankan dengan -o hasil.xml,xml (atau csv, junitxml) untuk output yang bisa dibandingkan
+TARGET = shiftnet-benchmarks
+TEMPLATE = app
+DESTDIR = $$PWD/../dist
+QT = core sql testlib
+CONFIG += console
+INCLUDEPATH += $$PWD/../src
+SOURCES += \
+    primitivesbenchmark.cpp \
+    ../src/client.cpp \
+    ../src/voucher.cpp \
+    ../src/vouchervalidator.cpp \
+    ../src/activevoucher.cpp \
+    ../src/database.cpp \
+    ../src/timingwheel.cpp \
+    ../src/frame.cpp \
+    ../src/metrics.cpp \
+    ../src/trace.cpp
+
+HEADERS  += \
+    ../src/client.h \
+    ../src/timingwheel.h \
+    ../src/frame.h \
+    ../src/metrics.h \
+    ../src/trace.h
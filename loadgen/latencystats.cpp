@@ -0,0 +1,51 @@
+#include "latencystats.h"
+
+#include <algorithm>
+
+using namespace shiftnet;
+
+LatencyStats::LatencyStats()
+    : _okCount(0)
+    , _failedCount(0)
+    , _errorCount(0)
+    , _sorted(true)
+{
+}
+
+void LatencyStats::add(Result result, qint64 nsecs)
+{
+    switch (result) {
+    case Ok:
+        _okCount++;
+        break;
+    case Failed:
+        _failedCount++;
+        break;
+    case Error:
+        // timeout tidak punya latency yang berarti
+        _errorCount++;
+        return;
+    }
+
+    _latencies.append(nsecs);
+    _sorted = false;
+}
+
+double LatencyStats::percentile(double q) const
+{
+    if (_latencies.isEmpty())
+        return 0;
+
+    if (!_sorted) {
+        std::sort(_latencies.begin(), _latencies.end());
+        _sorted = true;
+    }
+
+    const int index = qBound(0, int(q * _latencies.size() + 0.5) - 1, _latencies.size() - 1);
+    return _latencies.at(index) / 1e6;
+}
+
+double LatencyStats::max() const
+{
+    return percentile(1);
+}
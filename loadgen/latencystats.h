@@ -0,0 +1,42 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QVector>
+
+namespace shiftnet {
+
+// Hasil satu jenis operasi: berhasil, ditolak server (*-failed) atau error
+// (timeout, koneksi putus). Latency disimpan semua, persentil dihitung di akhir.
+class LatencyStats
+{
+public:
+    enum Result {
+        Ok,
+        Failed,
+        Error
+    };
+
+    LatencyStats();
+
+    void add(Result result, qint64 nsecs);
+
+    inline int count() const { return _okCount + _failedCount + _errorCount; }
+    inline int okCount() const { return _okCount; }
+    inline int failedCount() const { return _failedCount; }
+    inline int errorCount() const { return _errorCount; }
+
+    // dalam milidetik, dari operasi yang mendapat balasan
+    double percentile(double q) const;
+    double max() const;
+
+private:
+    int _okCount;
+    int _failedCount;
+    int _errorCount;
+    mutable QVector<qint64> _latencies;
+    mutable bool _sorted;
+};
+
+}
+
+#endif // LATENCYSTATS_H
@@ -0,0 +1,316 @@
+#include "loadgenerator.h"
+#include "simulatedseat.h"
+#include "simulatedmonitor.h"
+
+#include <QHostAddress>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+using namespace shiftnet;
+
+namespace {
+
+enum {
+    TickInterval      = 10,
+    ReconnectInterval = 1000
+};
+
+QTextStream& out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+int randomIndex(int count)
+{
+    return int(QRandomGenerator::global()->bounded(quint32(count)));
+}
+
+}
+
+LoadGenerator::LoadGenerator(const Options& options, QObject* parent)
+    : QObject(parent)
+    , _options(options)
+    , _lastTick(0)
+    , _lastReconnect(0)
+    , _seatTokens(0)
+    , _stopTokens(0)
+    , _saturatedCount(0)
+    , _intervalCount(0)
+    , _intervalErrorCount(0)
+{
+    _freeVouchers = options.vouchers;
+    for (const QPair<QString, QString>& member: options.members) {
+        _freeMembers << member.first;
+        _passwords.insert(member.first, member.second);
+    }
+
+    _tickTimer.setInterval(TickInterval);
+    _tickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&_tickTimer, SIGNAL(timeout()), SLOT(tick()));
+
+    _reportTimer.setInterval(qMax(1, options.reportInterval) * 1000);
+    connect(&_reportTimer, SIGNAL(timeout()), SLOT(report()));
+}
+
+void LoadGenerator::start()
+{
+    // seat ke-n memakai alamat base + n, harus terdaftar di shiftnet_clients
+    const quint32 base = QHostAddress(_options.seatBaseAddress).toIPv4Address();
+
+    for (int i = 0; i < _options.seatCount; i++) {
+        const QString address = base ? QHostAddress(base + i).toString() : QString();
+        SimulatedSeat* seat = new SimulatedSeat(i, address, this);
+        connect(seat, SIGNAL(finished(QString,int,qint64)), SLOT(onSeatFinished(QString,int,qint64)));
+        connect(seat, SIGNAL(released(QStringList,QString)), SLOT(onSeatReleased(QStringList,QString)));
+        _seats << seat;
+        seat->open(_options.url, _options.seatAddressHeader, _options.format);
+    }
+
+    for (int i = 0; i < _options.monitorCount; i++) {
+        SimulatedMonitor* monitor = new SimulatedMonitor(i, this);
+        connect(monitor, SIGNAL(finished(QString,int,qint64)), SLOT(onMonitorFinished(QString,int,qint64)));
+        _monitors << monitor;
+        monitor->open(_options.url, _options.format, true);
+    }
+
+    out() << "Load: " << _options.seatCount << " seats, " << _options.monitorCount << " monitors, "
+          << _options.rate << " ops/s, " << _options.stopRate << " stop-sessions/s against "
+          << _options.url.toString() << "\n";
+    out().flush();
+
+    _clock.start();
+    _tickTimer.start();
+    _reportTimer.start();
+
+    if (_options.duration > 0)
+        QTimer::singleShot(_options.duration * 1000, this, SLOT(stop()));
+}
+
+void LoadGenerator::tick()
+{
+    const qint64 now = _clock.elapsed();
+    const qint64 elapsed = now - _lastTick;
+    _lastTick = now;
+
+    // token yang tidak terpakai tidak ditumpuk lebih dari satu detik
+    _seatTokens = qMin(_seatTokens + _options.rate * elapsed / 1000, qMax(1.0, _options.rate));
+    while (_seatTokens >= 1) {
+        _seatTokens--;
+        issueSeatOperation();
+    }
+
+    _stopTokens = qMin(_stopTokens + _options.stopRate * elapsed / 1000, qMax(1.0, _options.stopRate));
+    while (_stopTokens >= 1) {
+        _stopTokens--;
+        issueStopSessions();
+    }
+
+    for (SimulatedSeat* seat: _seats)
+        seat->checkTimeout(_options.timeout);
+    for (SimulatedMonitor* monitor: _monitors)
+        monitor->checkTimeout(_options.timeout);
+
+    if (now - _lastReconnect >= ReconnectInterval) {
+        _lastReconnect = now;
+        reconnect();
+    }
+}
+
+void LoadGenerator::issueSeatOperation()
+{
+    if (_seats.isEmpty())
+        return;
+
+    // cari seat yang tidak sedang menunggu balasan, mulai dari posisi acak
+    SimulatedSeat* seat = 0;
+    const int start = randomIndex(_seats.size());
+    for (int i = 0; i < _seats.size() && !seat; i++) {
+        SimulatedSeat* candidate = _seats.at((start + i) % _seats.size());
+        if (!candidate->isBusy() && (candidate->state() == SimulatedSeat::Idle || candidate->state() == SimulatedSeat::InSession))
+            seat = candidate;
+    }
+
+    const bool hasVoucher = _options.vouchers.isEmpty() || !_freeVouchers.isEmpty();
+    QStringList operations;
+    if (seat && seat->state() == SimulatedSeat::Idle) {
+        if (hasVoucher)
+            operations << "guest-login";
+        if (!_freeMembers.isEmpty())
+            operations << "member-login";
+    }
+    else if (seat) {
+        if (hasVoucher)
+            operations << "user-topup";
+        operations << "session-stop";
+    }
+
+    int total = 0;
+    for (const QString& operation: operations)
+        total += _options.mix.value(operation);
+
+    if (total <= 0) {
+        _saturatedCount++;
+        return;
+    }
+
+    int pick = randomIndex(total);
+    QString operation;
+    for (const QString& candidate: operations) {
+        pick -= _options.mix.value(candidate);
+        if (pick < 0) {
+            operation = candidate;
+            break;
+        }
+    }
+
+    if (operation == "guest-login") {
+        seat->guestLogin(takeVoucher());
+    }
+    else if (operation == "member-login") {
+        const QString username = _freeMembers.takeAt(randomIndex(_freeMembers.size()));
+        seat->memberLogin(username, _passwords.value(username), QString());
+    }
+    else if (operation == "user-topup") {
+        seat->topup(takeVoucher());
+    }
+    else {
+        seat->stopSession();
+    }
+}
+
+void LoadGenerator::issueStopSessions()
+{
+    QList<SimulatedMonitor*> ready;
+    for (SimulatedMonitor* monitor: _monitors)
+        if (monitor->isReady())
+            ready << monitor;
+
+    if (ready.isEmpty() || _seats.isEmpty())
+        return;
+
+    QList<int> ids;
+    const int start = randomIndex(_seats.size());
+    for (int i = 0; i < _seats.size() && ids.size() < _options.stopBatch; i++) {
+        SimulatedSeat* seat = _seats.at((start + i) % _seats.size());
+        if (seat->state() == SimulatedSeat::InSession && !seat->isBusy() && seat->clientId() > 0) {
+            seat->setStopping();
+            ids << seat->clientId();
+        }
+    }
+
+    if (ids.isEmpty()) {
+        _saturatedCount++;
+        return;
+    }
+
+    ready.at(randomIndex(ready.size()))->stopSessions(ids);
+}
+
+void LoadGenerator::reconnect()
+{
+    for (SimulatedSeat* seat: _seats)
+        if (seat->state() == SimulatedSeat::Disconnected && !seat->isBusy())
+            seat->open(_options.url, _options.seatAddressHeader, _options.format);
+
+    for (SimulatedMonitor* monitor: _monitors)
+        if (monitor->isDisconnected())
+            monitor->open(_options.url, _options.format, true);
+}
+
+QString LoadGenerator::takeVoucher()
+{
+    // tanpa daftar voucher, kode acak menguji jalur voucher tidak dikenal
+    if (_options.vouchers.isEmpty())
+        return QString("LOAD%1").arg(QRandomGenerator::global()->generate(), 8, 16, QChar('0')).toUpper();
+
+    if (_freeVouchers.isEmpty())
+        return QString();
+
+    return _freeVouchers.takeAt(randomIndex(_freeVouchers.size()));
+}
+
+void LoadGenerator::onSeatFinished(const QString& operation, int result, qint64 nsecs)
+{
+    _stats[operation].add(LatencyStats::Result(result), nsecs);
+    _intervalCount++;
+    if (result == LatencyStats::Error)
+        _intervalErrorCount++;
+}
+
+void LoadGenerator::onSeatReleased(const QStringList& vouchers, const QString& member)
+{
+    if (!_options.vouchers.isEmpty())
+        for (const QString& voucher: vouchers)
+            if (!voucher.isEmpty())
+                _freeVouchers << voucher;
+
+    if (!member.isEmpty() && _passwords.contains(member))
+        _freeMembers << member;
+}
+
+void LoadGenerator::onMonitorFinished(const QString& operation, int result, qint64 nsecs)
+{
+    onSeatFinished(operation, result, nsecs);
+}
+
+void LoadGenerator::report()
+{
+    int connected = 0;
+    int inSession = 0;
+    for (SimulatedSeat* seat: _seats) {
+        if (seat->state() == SimulatedSeat::Idle || seat->state() == SimulatedSeat::InSession)
+            connected++;
+        if (seat->state() == SimulatedSeat::InSession)
+            inSession++;
+    }
+
+    const double seconds = _reportTimer.interval() / 1000.0;
+    out() << QString("%1s: %2 ops/s, %3 errors, %4/%5 seats connected, %6 in session")
+             .arg(_clock.elapsed() / 1000, 5)
+             .arg(_intervalCount / seconds, 0, 'f', 1)
+             .arg(_intervalErrorCount)
+             .arg(connected).arg(_seats.size()).arg(inSession) << "\n";
+    out().flush();
+
+    _intervalCount = 0;
+    _intervalErrorCount = 0;
+}
+
+void LoadGenerator::stop()
+{
+    _tickTimer.stop();
+    _reportTimer.stop();
+
+    printSummary();
+
+    for (SimulatedSeat* seat: _seats)
+        seat->close();
+    for (SimulatedMonitor* monitor: _monitors)
+        monitor->close();
+
+    emit done();
+}
+
+void LoadGenerator::printSummary()
+{
+    const double seconds = qMax(Q_INT64_C(1), _clock.elapsed()) / 1000.0;
+
+    out() << "\n"
+          << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+             .arg("operation", -16).arg("count", 8).arg("ok", 8).arg("failed", 8).arg("errors", 8)
+             .arg("ops/s", 9).arg("p50 ms", 9).arg("p90 ms", 9).arg("p99 ms", 9).arg("max ms", 9) << "\n";
+
+    for (QMap<QString, LatencyStats>::const_iterator it = _stats.constBegin(); it != _stats.constEnd(); ++it) {
+        const LatencyStats& stats = it.value();
+        out() << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9 %10")
+                 .arg(it.key(), -16).arg(stats.count(), 8).arg(stats.okCount(), 8)
+                 .arg(stats.failedCount(), 8).arg(stats.errorCount(), 8)
+                 .arg(stats.count() / seconds, 9, 'f', 1)
+                 .arg(stats.percentile(0.5), 9, 'f', 2).arg(stats.percentile(0.9), 9, 'f', 2)
+                 .arg(stats.percentile(0.99), 9, 'f', 2).arg(stats.max(), 9, 'f', 2) << "\n";
+    }
+
+    out() << "\nOperations skipped, no idle seat: " << _saturatedCount << "\n";
+    out().flush();
+}
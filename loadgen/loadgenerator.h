@@ -0,0 +1,92 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QUrl>
+
+#include "frame.h"
+#include "latencystats.h"
+
+namespace shiftnet {
+
+class SimulatedSeat;
+class SimulatedMonitor;
+
+// Menjalankan sejumlah seat dan monitor palsu terhadap server dengan laju
+// dan campuran operasi tertentu, lalu melaporkan throughput, persentil
+// latency dan jumlah error per operasi.
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QUrl url;
+        Frame::Format format;
+        int seatCount;
+        int monitorCount;
+        QString seatBaseAddress;
+        QByteArray seatAddressHeader;
+        double rate;
+        double stopRate;
+        int stopBatch;
+        QMap<QString, int> mix;
+        int duration;
+        int reportInterval;
+        int timeout;
+        QStringList vouchers;
+        QList<QPair<QString, QString>> members;
+    };
+
+    explicit LoadGenerator(const Options& options, QObject* parent = 0);
+
+    void start();
+
+signals:
+    void done();
+
+private slots:
+    void tick();
+    void report();
+    void stop();
+    void onSeatFinished(const QString& operation, int result, qint64 nsecs);
+    void onSeatReleased(const QStringList& vouchers, const QString& member);
+    void onMonitorFinished(const QString& operation, int result, qint64 nsecs);
+
+private:
+    void issueSeatOperation();
+    void issueStopSessions();
+    void reconnect();
+    QString takeVoucher();
+    void printSummary();
+
+    Options _options;
+    QList<SimulatedSeat*> _seats;
+    QList<SimulatedMonitor*> _monitors;
+    QStringList _freeVouchers;
+    QStringList _freeMembers;
+    QHash<QString, QString> _passwords;
+
+    QTimer _tickTimer;
+    QTimer _reportTimer;
+    QElapsedTimer _clock;
+    qint64 _lastTick;
+    qint64 _lastReconnect;
+    double _seatTokens;
+    double _stopTokens;
+    int _saturatedCount;
+
+    QMap<QString, LatencyStats> _stats;
+    int _intervalCount;
+    int _intervalErrorCount;
+};
+
+}
+
+#endif // LOADGENERATOR_H
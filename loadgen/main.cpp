@@ -0,0 +1,130 @@
+#include "loadgenerator.h"
+#include <iostream>
+#include <QFile>
+#include <QTextStream>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+using namespace shiftnet;
+
+namespace {
+
+QStringList readLines(const QString& fileName, bool* ok)
+{
+    QStringList lines;
+    *ok = true;
+    if (fileName.isEmpty())
+        return lines;
+
+    QFile file(fileName);
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        *ok = false;
+        return lines;
+    }
+
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith('#'))
+            lines << line;
+    }
+
+    return lines;
+}
+
+// format: guest-login=4,member-login=2,user-topup=2,session-stop=2
+bool parseMix(const QString& text, QMap<QString, int>* mix)
+{
+    const QStringList operations({ "guest-login", "member-login", "user-topup", "session-stop" });
+
+    for (const QString& entry: text.split(',', Qt::SkipEmptyParts)) {
+        const QStringList pair = entry.split('=');
+        bool ok = false;
+        const int weight = pair.size() == 2 ? pair.at(1).toInt(&ok) : 0;
+        if (!ok || weight < 0 || !operations.contains(pair.at(0).trimmed()))
+            return false;
+        mix->insert(pair.at(0).trimmed(), weight);
+    }
+
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    app.setApplicationName("shiftnet-loadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Load generator for ShiftNet Billing Server.");
+    parser.addHelpOption();
+    parser.addOptions({
+        { "url", "Server websocket URL.", "url", "ws://127.0.0.1:8080" },
+        { "clients", "Number of simulated seats.", "count", "100" },
+        { "monitors", "Number of simulated client monitors.", "count", "2" },
+        { "seat-base", "First seat IP address, seat n uses base + n.", "address" },
+        { "seat-header", "Handshake header carrying the seat address, must match Server/seatAddressHeader"
+                          " (server built with SHIFTNET_SEAT_ADDRESS_HEADER).",
+          "name", "X-Shiftnet-Seat" },
+        { "rate", "Seat operations per second, all seats combined.", "rate", "50" },
+        { "mix", "Operation weights.", "mix", "guest-login=4,member-login=2,user-topup=2,session-stop=2" },
+        { "stop-rate", "stop-sessions commands per second from monitors.", "rate", "1" },
+        { "stop-batch", "Seats per stop-sessions command.", "count", "1" },
+        { "vouchers", "File with one voucher code per line.", "file" },
+        { "members", "File with username:password per line.", "file" },
+        { "format", "Wire format, json or cbor.", "format", "json" },
+        { "duration", "Test duration in seconds, 0 runs until interrupted.", "seconds", "60" },
+        { "report", "Progress report interval in seconds.", "seconds", "5" },
+        { "timeout", "Reply timeout in milliseconds.", "msecs", "10000" },
+    });
+    parser.process(app);
+
+    LoadGenerator::Options options;
+    options.url = QUrl(parser.value("url"));
+    options.format = parser.value("format") == "cbor" ? Frame::Cbor : Frame::Json;
+    options.seatCount = qMax(0, parser.value("clients").toInt());
+    options.monitorCount = qMax(0, parser.value("monitors").toInt());
+    options.seatBaseAddress = parser.value("seat-base");
+    options.seatAddressHeader = parser.value("seat-header").toLatin1();
+    options.rate = qMax(0.0, parser.value("rate").toDouble());
+    options.stopRate = qMax(0.0, parser.value("stop-rate").toDouble());
+    options.stopBatch = qMax(1, parser.value("stop-batch").toInt());
+    options.duration = parser.value("duration").toInt();
+    options.reportInterval = parser.value("report").toInt();
+    options.timeout = qMax(1, parser.value("timeout").toInt());
+
+    if (!options.url.isValid()) {
+        std::cerr << "Invalid server URL." << std::endl;
+        return 2;
+    }
+
+    if (!parseMix(parser.value("mix"), &options.mix)) {
+        std::cerr << "Invalid operation mix." << std::endl;
+        return 2;
+    }
+
+    bool ok;
+    options.vouchers = readLines(parser.value("vouchers"), &ok);
+    if (!ok) {
+        std::cerr << "Voucher file not readable." << std::endl;
+        return 2;
+    }
+
+    const QStringList members = readLines(parser.value("members"), &ok);
+    if (!ok) {
+        std::cerr << "Member file not readable." << std::endl;
+        return 2;
+    }
+    for (const QString& member: members) {
+        const int separator = member.indexOf(':');
+        if (separator > 0)
+            options.members << qMakePair(member.left(separator), member.mid(separator + 1));
+    }
+
+    LoadGenerator generator(options);
+    QObject::connect(&generator, SIGNAL(done()), &app, SLOT(quit()));
+    generator.start();
+
+    return app.exec();
+}
@@ -0,0 +1,20 @@
+TARGET = shiftnet-loadgen
+TEMPLATE = app
+DESTDIR = $$PWD/../dist
+QT = core network websockets
+CONFIG += console
+INCLUDEPATH += $$PWD/../src
+SOURCES += \
+    main.cpp \
+    latencystats.cpp \
+    simulatedseat.cpp \
+    simulatedmonitor.cpp \
+    loadgenerator.cpp \
+    ../src/frame.cpp
+
+HEADERS  += \
+    latencystats.h \
+    simulatedseat.h \
+    simulatedmonitor.h \
+    loadgenerator.h \
+    ../src/frame.h
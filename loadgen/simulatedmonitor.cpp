@@ -0,0 +1,161 @@
+#include "simulatedmonitor.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborArray>
+#include <QVariantList>
+#include <QVariantMap>
+
+using namespace shiftnet;
+
+SimulatedMonitor::SimulatedMonitor(int index, QObject* parent)
+    : QObject(parent)
+    , _index(index)
+    , _ready(false)
+    , _connecting(false)
+    , _clientsSync(false)
+    , _format(Frame::Json)
+    , _connectStarted(0)
+    , _stream(0)
+    , _sequence(0)
+    , _receivedCount(0)
+{
+    _clock.start();
+
+    connect(&_socket, SIGNAL(connected()), SLOT(onConnected()));
+    connect(&_socket, SIGNAL(disconnected()), SLOT(onDisconnected()));
+    connect(&_socket, SIGNAL(textMessageReceived(QString)), SLOT(onTextMessageReceived(QString)));
+    connect(&_socket, SIGNAL(binaryMessageReceived(QByteArray)), SLOT(onBinaryMessageReceived(QByteArray)));
+}
+
+void SimulatedMonitor::open(const QUrl& url, Frame::Format format, bool clientsSync)
+{
+    _format = format;
+    _clientsSync = clientsSync;
+    _connecting = true;
+    _connectStarted = _clock.nsecsElapsed();
+    _socket.open(url);
+}
+
+void SimulatedMonitor::close()
+{
+    _socket.close();
+}
+
+void SimulatedMonitor::stopSessions(const QList<int>& clientIds)
+{
+    QVariantList ids;
+    const qint64 now = _clock.nsecsElapsed();
+    for (int id: clientIds) {
+        _pendingStops.insert(id, now);
+        ids << id;
+    }
+
+    send("stop-sessions", ids);
+}
+
+void SimulatedMonitor::checkTimeout(qint64 timeout)
+{
+    const qint64 deadline = _clock.nsecsElapsed() - timeout * 1000000;
+
+    if (_connecting && _connectStarted < deadline) {
+        _connecting = false;
+        emit finished("monitor-connect", LatencyStats::Error, 0);
+        _socket.abort();
+    }
+
+    QHash<int, qint64>::iterator it = _pendingStops.begin();
+    while (it != _pendingStops.end()) {
+        if (it.value() < deadline) {
+            emit finished("stop-sessions", LatencyStats::Error, 0);
+            it = _pendingStops.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void SimulatedMonitor::onConnected()
+{
+    // setelah tersambung ulang minta event yang terlewat saja
+    send("init", QVariantMap({
+        { "clientsSync", _clientsSync },
+        { "aggregateStops", true },
+        { "resumeFrom", _sequence },
+        { "stream", _stream },
+    }));
+}
+
+void SimulatedMonitor::onDisconnected()
+{
+    if (_connecting)
+        emit finished("monitor-connect", LatencyStats::Error, 0);
+
+    for (int i = 0; i < _pendingStops.size(); i++)
+        emit finished("stop-sessions", LatencyStats::Error, 0);
+
+    _pendingStops.clear();
+    _connecting = false;
+    _ready = false;
+}
+
+void SimulatedMonitor::onTextMessageReceived(const QString& message)
+{
+    QVariantList data;
+    if (Frame::decode(message.toUtf8(), Frame::Json, &data) && data.size() >= 2)
+        process(data.at(0).toString(), data.at(1), data.value(2).toULongLong());
+}
+
+void SimulatedMonitor::onBinaryMessageReceived(const QByteArray& message)
+{
+    QVariantList data;
+    if (Frame::decode(message, Frame::Cbor, &data) && data.size() >= 2)
+        process(data.at(0).toString(), data.at(1), data.value(2).toULongLong());
+}
+
+void SimulatedMonitor::send(const QString& type, const QVariant& message)
+{
+    const QVariantList data({ "client-monitor", type, message });
+    if (_format == Frame::Cbor)
+        _socket.sendBinaryMessage(QCborArray::fromVariantList(data).toCborValue().toCbor());
+    else
+        _socket.sendTextMessage(QString::fromUtf8(QJsonDocument(QJsonArray::fromVariantList(data)).toJson(QJsonDocument::Compact)));
+}
+
+void SimulatedMonitor::process(const QString& type, const QVariant& message, quint64 sequence)
+{
+    _receivedCount++;
+    if (sequence)
+        _sequence = sequence;
+
+    if (type == "init" || type == "resume") {
+        const QVariantMap map = message.toMap();
+        _stream = map.value("stream").toULongLong();
+        _sequence = map.value(type == "init" ? "sequence" : "from").toULongLong();
+
+        if (_connecting)
+            emit finished(type == "init" ? "monitor-connect" : "monitor-resume", LatencyStats::Ok,
+                          _clock.nsecsElapsed() - _connectStarted);
+        _connecting = false;
+        _ready = true;
+    }
+    else if (type == "stop-sessions-result") {
+        // latensi dihitung sampai hasil per PC tersimpan di database
+        const QVariantMap result = message.toMap();
+        const bool persisted = result.value("persisted").toBool();
+
+        for (const QVariant& seat: result.value("results").toList()) {
+            const QVariantMap map = seat.toMap();
+            QHash<int, qint64>::iterator it = _pendingStops.find(map.value("id").toInt());
+            if (it == _pendingStops.end())
+                continue;
+
+            const QString status = map.value("result").toString();
+            const bool ok = persisted && (status == "stopped" || status == "maintenance-stopped");
+            emit finished("stop-sessions", ok ? LatencyStats::Ok : LatencyStats::Failed,
+                          _clock.nsecsElapsed() - it.value());
+            _pendingStops.erase(it);
+        }
+    }
+}
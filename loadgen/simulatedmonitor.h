@@ -0,0 +1,65 @@
+#ifndef SIMULATEDMONITOR_H
+#define SIMULATEDMONITOR_H
+
+#include <QObject>
+#include <QWebSocket>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QUrl>
+
+#include "frame.h"
+#include "latencystats.h"
+
+namespace shiftnet {
+
+// Client-monitor palsu yang menerima semua notifikasi dan sesekali
+// menghentikan sesi lewat stop-sessions. Latency stop-sessions dihitung
+// sampai client-session-stop untuk PC tersebut diterima.
+class SimulatedMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SimulatedMonitor(int index, QObject* parent = 0);
+
+    void open(const QUrl& url, Frame::Format format, bool clientsSync);
+    void close();
+
+    inline int index() const { return _index; }
+    inline bool isReady() const { return _ready; }
+    inline bool isDisconnected() const { return _socket.state() == QAbstractSocket::UnconnectedState && !_connecting; }
+    inline quint64 receivedCount() const { return _receivedCount; }
+
+    void stopSessions(const QList<int>& clientIds);
+    void checkTimeout(qint64 timeout);
+
+signals:
+    void finished(const QString& operation, int result, qint64 nsecs);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onTextMessageReceived(const QString& message);
+    void onBinaryMessageReceived(const QByteArray& message);
+
+private:
+    void send(const QString& type, const QVariant& message);
+    void process(const QString& type, const QVariant& message, quint64 sequence);
+
+    int _index;
+    bool _ready;
+    bool _connecting;
+    bool _clientsSync;
+    Frame::Format _format;
+    QWebSocket _socket;
+    QElapsedTimer _clock;
+    qint64 _connectStarted;
+    quint64 _stream;
+    quint64 _sequence;
+    QHash<int, qint64> _pendingStops;
+    quint64 _receivedCount;
+};
+
+}
+
+#endif // SIMULATEDMONITOR_H
@@ -0,0 +1,199 @@
+#include "simulatedseat.h"
+
+#include <QNetworkRequest>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborArray>
+#include <QVariantList>
+
+using namespace shiftnet;
+
+SimulatedSeat::SimulatedSeat(int index, const QString& address, QObject* parent)
+    : QObject(parent)
+    , _index(index)
+    , _clientId(0)
+    , _address(address)
+    , _state(Disconnected)
+    , _format(Frame::Json)
+    , _stopping(false)
+{
+    connect(&_socket, SIGNAL(connected()), SLOT(onConnected()));
+    connect(&_socket, SIGNAL(disconnected()), SLOT(onDisconnected()));
+    connect(&_socket, SIGNAL(textMessageReceived(QString)), SLOT(onTextMessageReceived(QString)));
+    connect(&_socket, SIGNAL(binaryMessageReceived(QByteArray)), SLOT(onBinaryMessageReceived(QByteArray)));
+}
+
+void SimulatedSeat::open(const QUrl& url, const QByteArray& addressHeader, Frame::Format format)
+{
+    QNetworkRequest request(url);
+    if (!addressHeader.isEmpty() && !_address.isEmpty())
+        request.setRawHeader(addressHeader, _address.toLatin1());
+
+    _format = format;
+    _state = Connecting;
+    _operation = "connect";
+    _timer.start();
+    _socket.open(request);
+}
+
+void SimulatedSeat::close()
+{
+    _socket.close();
+}
+
+void SimulatedSeat::guestLogin(const QString& voucherCode)
+{
+    _pendingVoucher = voucherCode;
+    begin("guest-login", "guest-login", QVariantList({ QString("load-%1").arg(_index), voucherCode }));
+}
+
+void SimulatedSeat::memberLogin(const QString& username, const QString& password, const QString& voucherCode)
+{
+    _pendingMember = username;
+    _pendingVoucher = voucherCode;
+    begin("member-login", "member-login", QVariantList({ username, password, voucherCode }));
+}
+
+void SimulatedSeat::topup(const QString& voucherCode)
+{
+    _pendingVoucher = voucherCode;
+    begin("user-topup", "user-topup", voucherCode);
+}
+
+void SimulatedSeat::stopSession()
+{
+    begin("session-stop", "session-stop", QVariant());
+}
+
+void SimulatedSeat::checkTimeout(qint64 timeout)
+{
+    if (!_operation.isEmpty() && _timer.elapsed() > timeout) {
+        // balasan yang terlambat tidak bisa dibedakan lagi, mulai dari awal
+        finish(LatencyStats::Error);
+        _socket.abort();
+        endSession();
+        _state = Disconnected;
+        _clientId = 0;
+    }
+}
+
+void SimulatedSeat::onConnected()
+{
+    // operasi connect selesai saat init dibalas
+    send("init", "");
+}
+
+void SimulatedSeat::onDisconnected()
+{
+    if (!_operation.isEmpty())
+        finish(LatencyStats::Error);
+
+    endSession();
+    _state = Disconnected;
+    _clientId = 0;
+}
+
+void SimulatedSeat::onTextMessageReceived(const QString& message)
+{
+    QVariantList data;
+    if (Frame::decode(message.toUtf8(), Frame::Json, &data) && data.size() == 2)
+        process(data.at(0).toString(), data.at(1));
+}
+
+void SimulatedSeat::onBinaryMessageReceived(const QByteArray& message)
+{
+    QVariantList data;
+    if (Frame::decode(message, Frame::Cbor, &data) && data.size() == 2)
+        process(data.at(0).toString(), data.at(1));
+}
+
+void SimulatedSeat::begin(const QString& operation, const QString& type, const QVariant& message)
+{
+    _operation = operation;
+    _timer.start();
+    send(type, message);
+}
+
+void SimulatedSeat::send(const QString& type, const QVariant& message)
+{
+    const QVariantList data({ "client", type, message });
+    if (_format == Frame::Cbor)
+        _socket.sendBinaryMessage(QCborArray::fromVariantList(data).toCborValue().toCbor());
+    else
+        _socket.sendTextMessage(QString::fromUtf8(QJsonDocument(QJsonArray::fromVariantList(data)).toJson(QJsonDocument::Compact)));
+}
+
+void SimulatedSeat::finish(LatencyStats::Result result)
+{
+    const QString operation = _operation;
+    _operation.clear();
+
+    // voucher atau member yang gagal dipakai dikembalikan
+    if (result != LatencyStats::Ok && (!_pendingVoucher.isEmpty() || !_pendingMember.isEmpty()))
+        emit released(_pendingVoucher.isEmpty() ? QStringList() : QStringList(_pendingVoucher), _pendingMember);
+    _pendingVoucher.clear();
+    _pendingMember.clear();
+
+    emit finished(operation, result, _timer.nsecsElapsed());
+}
+
+void SimulatedSeat::process(const QString& type, const QVariant& message)
+{
+    if (type == "init") {
+        _clientId = message.toMap().value("client").toMap().value("id").toInt();
+        _state = Idle;
+        if (_operation == "connect")
+            finish(LatencyStats::Ok);
+    }
+    else if (type == "session-start") {
+        startSession();
+        if (_operation == "guest-login" || _operation == "member-login")
+            finish(LatencyStats::Ok);
+    }
+    else if (type == "guest-login-failed" || type == "member-login-failed" || type == "user-topup-failed") {
+        if (_operation == type.left(type.size() - 7))
+            finish(LatencyStats::Failed);
+    }
+    else if (type == "user-topup-success") {
+        // topup member langsung menambah saldo, vouchernya habis dipakai
+        if (!isMember())
+            _vouchers << _pendingVoucher;
+        _pendingVoucher.clear();
+        if (_operation == "user-topup")
+            finish(LatencyStats::Ok);
+    }
+    else if (type == "session-stop" || type == "session-timeout") {
+        const bool requested = _operation == "session-stop";
+        endSession();
+        if (requested)
+            finish(LatencyStats::Ok);
+        else if (!_operation.isEmpty())
+            finish(LatencyStats::Failed);
+    }
+}
+
+void SimulatedSeat::startSession()
+{
+    _state = InSession;
+
+    // voucher guest tetap terikat ke seat, voucher login member langsung habis
+    if (!_pendingMember.isEmpty())
+        _member = _pendingMember;
+    else if (!_pendingVoucher.isEmpty())
+        _vouchers << _pendingVoucher;
+
+    _pendingMember.clear();
+    _pendingVoucher.clear();
+}
+
+void SimulatedSeat::endSession()
+{
+    if (!_vouchers.isEmpty() || !_member.isEmpty())
+        emit released(_vouchers, _member);
+
+    _vouchers.clear();
+    _member.clear();
+    _stopping = false;
+    if (_state == InSession)
+        _state = Idle;
+}
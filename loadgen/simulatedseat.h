@@ -0,0 +1,91 @@
+#ifndef SIMULATEDSEAT_H
+#define SIMULATEDSEAT_H
+
+#include <QObject>
+#include <QWebSocket>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QUrl>
+
+#include "frame.h"
+#include "latencystats.h"
+
+namespace shiftnet {
+
+// Satu PC palsu dengan protokol yang sama seperti aplikasi client:
+// init, guest-login, member-login, user-topup dan session-stop.
+// Hanya satu operasi yang berjalan dalam satu waktu.
+class SimulatedSeat : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum State {
+        Disconnected,
+        Connecting,
+        Idle,
+        InSession
+    };
+
+    SimulatedSeat(int index, const QString& address, QObject* parent = 0);
+
+    void open(const QUrl& url, const QByteArray& addressHeader, Frame::Format format);
+    void close();
+
+    inline int index() const { return _index; }
+    inline int clientId() const { return _clientId; }
+    inline QString address() const { return _address; }
+    inline State state() const { return _state; }
+    inline bool isBusy() const { return !_operation.isEmpty() || _stopping; }
+    inline bool isMember() const { return !_member.isEmpty(); }
+
+    void guestLogin(const QString& voucherCode);
+    void memberLogin(const QString& username, const QString& password, const QString& voucherCode);
+    void topup(const QString& voucherCode);
+    void stopSession();
+
+    // sesi akan dihentikan dari monitor, jangan diberi operasi lain
+    inline void setStopping() { _stopping = true; }
+
+    void checkTimeout(qint64 timeout);
+
+signals:
+    void finished(const QString& operation, int result, qint64 nsecs);
+    // voucher dan member yang tidak lagi dipakai seat ini
+    void released(const QStringList& vouchers, const QString& member);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onTextMessageReceived(const QString& message);
+    void onBinaryMessageReceived(const QByteArray& message);
+
+private:
+    void begin(const QString& operation, const QString& type, const QVariant& message);
+    void send(const QString& type, const QVariant& message);
+    void finish(LatencyStats::Result result);
+    void process(const QString& type, const QVariant& message);
+    void startSession();
+    void endSession();
+
+    int _index;
+    int _clientId;
+    QString _address;
+    State _state;
+    Frame::Format _format;
+    QWebSocket _socket;
+
+    QString _operation;
+    QElapsedTimer _timer;
+    bool _stopping;
+
+    // voucher dan member yang sedang dicoba atau dipakai
+    QString _pendingVoucher;
+    QString _pendingMember;
+    QStringList _vouchers;
+    QString _member;
+};
+
+}
+
+#endif // SIMULATEDSEAT_H
@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+SUBDIRS = \
+    src/shiftnet-billing-server.pro \
+    loadgen/shiftnet-loadgen.pro \
+    benchmarks/shiftnet-benchmarks.pro \
+    tests/shiftnet-tests.pro
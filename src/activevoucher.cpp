@@ -0,0 +1,21 @@
+#include "activevoucher.h"
+
+#include <QSqlRecord>
+#include <QVariant>
+
+using namespace shiftnet;
+
+ActiveVoucher ActiveVoucher::fromRecord(const QSqlRecord& record)
+{
+    ActiveVoucher voucher;
+    if (record.isEmpty())
+        return voucher;
+
+    voucher._id = record.value("id").value<quint64>();
+    voucher._code = record.value("code").toString();
+    voucher._lastActiveUsername = record.value("lastActiveUsername").toString();
+    voucher._remainingDuration = record.value("remainingDuration").toInt();
+    voucher._activeClientId = record.value("activeClientId").toInt();
+    voucher._expirationDateTime = record.value("expirationDateTime").toDateTime();
+    return voucher;
+}
@@ -0,0 +1,51 @@
+#ifndef ACTIVEVOUCHER_H
+#define ACTIVEVOUCHER_H
+
+#include <QString>
+#include <QDateTime>
+
+#include "voucher.h"
+
+class QSqlRecord;
+
+namespace shiftnet {
+
+// Satu baris shiftnet_active_vouchers beserta tanggal kadaluarsanya.
+class ActiveVoucher
+{
+public:
+    inline ActiveVoucher()
+        : _id(0)
+        , _remainingDuration(0)
+        , _activeClientId(0)
+    {}
+
+    static ActiveVoucher fromRecord(const QSqlRecord& record);
+
+    inline bool isNull() const { return _code.isEmpty(); }
+
+    inline quint64 id() const { return _id; }
+    inline QString code() const { return _code; }
+    inline QString lastActiveUsername() const { return _lastActiveUsername; }
+    inline int remainingDuration() const { return _remainingDuration; }
+    inline int activeClientId() const { return _activeClientId; }
+    inline QDateTime expirationDateTime() const { return _expirationDateTime; }
+
+    inline void setLastActiveUsername(const QString& username) { _lastActiveUsername = username; }
+    inline void setRemainingDuration(int duration) { _remainingDuration = duration; }
+    inline void setActiveClientId(int clientId) { _activeClientId = clientId; }
+
+    inline Voucher toVoucher() const { return Voucher(_code, _remainingDuration, _id); }
+
+private:
+    quint64 _id;
+    QString _code;
+    QString _lastActiveUsername;
+    int _remainingDuration;
+    int _activeClientId;
+    QDateTime _expirationDateTime;
+};
+
+}
+
+#endif // ACTIVEVOUCHER_H
@@ -0,0 +1,45 @@
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+
+#include <QDateTime>
+
+#include "user.h"
+
+namespace shiftnet {
+
+class Activity
+{
+public:
+    inline Activity()
+        : _clientId(0)
+        , _voucherId(0)
+    {}
+
+    inline Activity(int clientId, const User& user, const QString& type, const QString& detail, quint64 voucherId = 0)
+        : _dateTime(QDateTime::currentDateTime())
+        , _clientId(clientId)
+        , _voucherId(voucherId)
+        , _user(user)
+        , _type(type)
+        , _detail(detail)
+    {}
+
+    inline QDateTime dateTime() const { return _dateTime; }
+    inline int clientId() const { return _clientId; }
+    inline quint64 voucherId() const { return _voucherId; }
+    inline User user() const { return _user; }
+    inline QString type() const { return _type; }
+    inline QString detail() const { return _detail; }
+
+private:
+    QDateTime _dateTime;
+    int _clientId;
+    quint64 _voucherId;
+    User _user;
+    QString _type;
+    QString _detail;
+};
+
+}
+
+#endif // ACTIVITY_H
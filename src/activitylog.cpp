@@ -0,0 +1,99 @@
+#include "activitylog.h"
+#include "database.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+using namespace shiftnet;
+
+ActivityLog::ActivityLog(QObject* parent)
+    : QThread(parent)
+    , _capacity(10000)
+    , _batchSize(100)
+    , _stopping(false)
+    , _dropped(0)
+{
+}
+
+ActivityLog::~ActivityLog()
+{
+    stop();
+}
+
+void ActivityLog::setCapacity(int capacity)
+{
+    QMutexLocker locker(&_mutex);
+    _capacity = qMax(1, capacity);
+}
+
+void ActivityLog::setBatchSize(int batchSize)
+{
+    QMutexLocker locker(&_mutex);
+    _batchSize = qMax(1, batchSize);
+}
+
+void ActivityLog::log(int clientId, const User& user, const QString& type, const QString& detail, quint64 voucherId)
+{
+    log(Activity(clientId, user, type, detail, voucherId));
+}
+
+void ActivityLog::log(const Activity& activity)
+{
+    QMutexLocker locker(&_mutex);
+
+    if (_queue.size() >= _capacity) {
+        if (_dropped++ % 100 == 0)
+            qWarning() << "Activity log queue full," << _dropped << "activities dropped.";
+        return;
+    }
+
+    _queue.enqueue(activity);
+    _condition.wakeOne();
+}
+
+void ActivityLog::stop()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stopping = true;
+        _condition.wakeOne();
+    }
+
+    wait();
+}
+
+int ActivityLog::pendingCount() const
+{
+    QMutexLocker locker(&_mutex);
+    return _queue.size();
+}
+
+quint64 ActivityLog::droppedCount() const
+{
+    QMutexLocker locker(&_mutex);
+    return _dropped;
+}
+
+void ActivityLog::run()
+{
+    for (;;) {
+        QList<Activity> activities;
+
+        {
+            QMutexLocker locker(&_mutex);
+            while (_queue.isEmpty() && !_stopping)
+                _condition.wait(&_mutex);
+
+            // antrian dikosongkan dulu sebelum berhenti
+            if (_queue.isEmpty())
+                break;
+
+            while (!_queue.isEmpty() && activities.size() < _batchSize)
+                activities.append(_queue.dequeue());
+        }
+
+        Database::logUserActivities(activities);
+    }
+
+    Database::closeConnection();
+}
@@ -0,0 +1,47 @@
+#ifndef ACTIVITYLOG_H
+#define ACTIVITYLOG_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+
+#include "activity.h"
+
+namespace shiftnet {
+
+// Menulis shiftnet_activities di thread terpisah dengan multi-row insert.
+class ActivityLog : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit ActivityLog(QObject* parent = 0);
+    ~ActivityLog();
+
+    void setCapacity(int capacity);
+    void setBatchSize(int batchSize);
+
+    void log(int clientId, const User& user, const QString& type, const QString& detail, quint64 voucherId = 0);
+    void log(const Activity& activity);
+    void stop();
+
+    int pendingCount() const;
+    quint64 droppedCount() const;
+
+protected:
+    void run();
+
+private:
+    mutable QMutex _mutex;
+    QWaitCondition _condition;
+    QQueue<Activity> _queue;
+    int _capacity;
+    int _batchSize;
+    bool _stopping;
+    quint64 _dropped;
+};
+
+}
+
+#endif // ACTIVITYLOG_H
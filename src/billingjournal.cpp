@@ -0,0 +1,279 @@
+#include "billingjournal.h"
+#include "user.h"
+#include "voucher.h"
+
+#include <QDateTime>
+#include <QMap>
+#include <QDebug>
+
+#include <cstring>
+#include <cstddef>
+
+namespace shiftnet {
+
+struct BillingJournal::Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 recordSize;
+    quint32 capacity;
+    quint64 checkpointSequence;
+    char reserved[40];
+};
+
+// ukuran tetap 64 byte, sequence 0 berarti slot kosong
+struct BillingJournal::Record
+{
+    quint64 sequence;
+    qint64 timestamp;
+    quint32 type;
+    qint32 clientId;
+    qint32 memberId;
+    qint32 duration;
+    char voucherCode[28];
+    quint32 checksum;
+};
+
+}
+
+using namespace shiftnet;
+
+namespace {
+
+const quint32 JournalMagic = 0x534e424a;
+const quint32 JournalVersion = 1;
+
+// FNV-1a, cukup untuk mengenali record yang terpotong
+quint32 checksum(const void* data, int size)
+{
+    const uchar* bytes = static_cast<const uchar*>(data);
+    quint32 hash = 2166136261u;
+    for (int i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+}
+
+BillingJournal::BillingJournal()
+    : _header(0)
+    , _records(0)
+    , _capacity(0)
+    , _lastSequence(0)
+    , _syncedSequence(0)
+    , _droppedCount(0)
+{
+    Q_STATIC_ASSERT(sizeof(Header) == 64);
+    Q_STATIC_ASSERT(sizeof(Record) == 64);
+}
+
+BillingJournal::~BillingJournal()
+{
+    close();
+}
+
+bool BillingJournal::open(const QString& fileName, int capacity)
+{
+    close();
+
+    _file.setFileName(fileName);
+    if (!_file.open(QFile::ReadWrite)) {
+        qWarning() << "Journal" << qPrintable(fileName) << "cannot be opened:" << qPrintable(_file.errorString());
+        return false;
+    }
+
+    // file baru atau rusak dimulai dari kosong
+    Header header;
+    if (_file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header)
+            || header.magic != JournalMagic || header.version != JournalVersion
+            || header.recordSize != sizeof(Record) || header.capacity == 0
+            || _file.size() < qint64(sizeof(Header)) + qint64(header.capacity) * qint64(sizeof(Record))) {
+        return reset(capacity);
+    }
+
+    _capacity = int(header.capacity);
+    if (!map())
+        return false;
+
+    _lastSequence = _header->checkpointSequence;
+    for (int i = 0; i < _capacity; i++) {
+        const Record& record = _records[i];
+        if (record.sequence > _lastSequence && record.checksum == checksum(&record, offsetof(Record, checksum)))
+            _lastSequence = record.sequence;
+    }
+
+    _syncedSequence = _lastSequence;
+    return true;
+}
+
+void BillingJournal::close()
+{
+    _syncer.waitForIdle();
+    if (_header)
+        _file.unmap(reinterpret_cast<uchar*>(_header));
+
+    _header = 0;
+    _records = 0;
+    _file.close();
+}
+
+void BillingJournal::recover(QHash<int, int>* members, QHash<QString, int>* vouchers,
+                             QHash<QString, PendingTopup>* topups) const
+{
+    if (!isOpen())
+        return;
+
+    // slot bisa berisi record lama yang sudah ditimpa sebagian, urutkan berdasarkan sequence
+    QMap<quint64, const Record*> records;
+    const quint64 checkpoint = _header->checkpointSequence;
+    for (int i = 0; i < _capacity; i++) {
+        const Record& record = _records[i];
+        if (record.sequence > checkpoint && record.checksum == checksum(&record, offsetof(Record, checksum)))
+            records.insert(record.sequence, &record);
+    }
+
+    for (const Record* record: records) {
+        const QString code = QString::fromUtf8(record->voucherCode, qstrnlen(record->voucherCode, sizeof(record->voucherCode)));
+
+        if (record->type == TopupPending) {
+            const PendingTopup topup = { record->memberId, record->duration };
+            topups->insert(code, topup);
+            continue;
+        }
+
+        if (record->type == TopupFailed || record->type == Topup)
+            topups->remove(code);
+
+        if (record->type == TopupFailed)
+            continue;
+
+        if (record->memberId)
+            members->insert(record->memberId, record->duration);
+        else if (!code.isEmpty())
+            vouchers->insert(code, record->duration);
+    }
+}
+
+bool BillingJournal::reset(int capacity)
+{
+    capacity = qMax(1, capacity);
+
+    _syncer.waitForIdle();
+    if (_header)
+        _file.unmap(reinterpret_cast<uchar*>(_header));
+    _header = 0;
+    _records = 0;
+
+    const qint64 size = qint64(sizeof(Header)) + qint64(capacity) * qint64(sizeof(Record));
+    if (!_file.resize(size)) {
+        qWarning() << "Journal" << qPrintable(_file.fileName()) << "cannot be resized:" << qPrintable(_file.errorString());
+        return false;
+    }
+
+    _capacity = capacity;
+    if (!map())
+        return false;
+
+    // sequence tetap naik supaya record lama tidak pernah dianggap baru
+    std::memset(_header, 0, size);
+    _header->magic = JournalMagic;
+    _header->version = JournalVersion;
+    _header->recordSize = sizeof(Record);
+    _header->capacity = quint32(capacity);
+    _header->checkpointSequence = _lastSequence;
+
+    _syncedSequence = _lastSequence;
+    _syncer.sync(reinterpret_cast<uchar*>(_header), size);
+    return true;
+}
+
+bool BillingJournal::append(RecordType type, int clientId, const User& user, const Voucher& voucher)
+{
+    if (!isOpen())
+        return false;
+
+    // slot berikutnya belum masuk checkpoint, lebih baik kehilangan jurnal daripada menimpa
+    if (_lastSequence - _header->checkpointSequence >= quint64(_capacity)) {
+        if (_droppedCount++ == 0)
+            qWarning() << "Journal full, records are dropped until the next checkpoint";
+        return false;
+    }
+
+    Record record;
+    std::memset(&record, 0, sizeof(record));
+    record.sequence = _lastSequence + 1;
+    record.timestamp = QDateTime::currentMSecsSinceEpoch();
+    record.type = type;
+    record.clientId = clientId;
+
+    if (user.isMember()) {
+        record.memberId = user.id();
+        record.duration = type == TopupPending ? voucher.duration() : user.duration();
+    }
+    else {
+        record.duration = voucher.duration();
+    }
+
+    const QByteArray code = voucher.code().toUtf8();
+    std::memcpy(record.voucherCode, code.constData(), qMin(code.size(), int(sizeof(record.voucherCode)) - 1));
+    record.checksum = checksum(&record, offsetof(Record, checksum));
+
+    *slot(record.sequence) = record;
+    _lastSequence = record.sequence;
+
+    return true;
+}
+
+void BillingJournal::checkpoint(quint64 sequence)
+{
+    if (isOpen() && sequence > _header->checkpointSequence)
+        _header->checkpointSequence = qMin(sequence, _lastSequence);
+}
+
+void BillingJournal::sync()
+{
+    // tanpa msync isi jurnal tetap aman jika hanya proses yang mati. Jika listrik
+    // padam, record yang belum selesai disinkronkan (sekitar satu interval flush) hilang.
+    if (!isOpen())
+        return;
+
+    if (!_syncer.isRunning())
+        _syncer.start(QThread::LowPriority);
+
+    // hanya slot sesudah sync sebelumnya, bisa terbagi dua jika melewati akhir file
+    const int dirty = int(qMin(_lastSequence - _syncedSequence, quint64(_capacity)));
+    const int first = int(_syncedSequence % quint64(_capacity));
+    const int head = qMin(dirty, _capacity - first);
+    uchar* records = reinterpret_cast<uchar*>(_records);
+    _syncer.sync(records + qint64(first) * sizeof(Record), qint64(head) * sizeof(Record));
+    _syncer.sync(records, qint64(dirty - head) * sizeof(Record));
+
+    // checkpoint ada di header
+    _syncer.sync(reinterpret_cast<uchar*>(_header), sizeof(Header));
+    _syncedSequence = _lastSequence;
+}
+
+quint64 BillingJournal::checkpointSequence() const
+{
+    return isOpen() ? _header->checkpointSequence : _lastSequence;
+}
+
+bool BillingJournal::map()
+{
+    uchar* data = _file.map(0, qint64(sizeof(Header)) + qint64(_capacity) * qint64(sizeof(Record)));
+    if (!data) {
+        qWarning() << "Journal" << qPrintable(_file.fileName()) << "cannot be mapped:" << qPrintable(_file.errorString());
+        return false;
+    }
+
+    _header = reinterpret_cast<Header*>(data);
+    _records = reinterpret_cast<Record*>(data + sizeof(Header));
+    return true;
+}
+
+BillingJournal::Record* BillingJournal::slot(quint64 sequence) const
+{
+    return &_records[(sequence - 1) % quint64(_capacity)];
+}
@@ -0,0 +1,81 @@
+#ifndef BILLINGJOURNAL_H
+#define BILLINGJOURNAL_H
+
+#include <QFile>
+#include <QHash>
+
+#include "journalsyncer.h"
+
+namespace shiftnet {
+
+class User;
+class Voucher;
+
+// Jurnal biner append-only untuk setiap tick, topup dan awal/akhir sesi.
+// File dipetakan ke memori dan dipakai bergiliran: sebuah slot hanya ditimpa
+// jika isinya sudah masuk SQL lewat checkpoint. Setelah crash, record sesudah
+// checkpoint terakhir berisi sisa waktu terbaru setiap member dan voucher.
+class BillingJournal
+{
+public:
+    enum RecordType {
+        Tick = 1,
+        Topup,
+        SessionStart,
+        SessionStop,
+        // dicatat sebelum topup member dikirim ke SQL, durasinya durasi voucher
+        TopupPending,
+        TopupFailed
+    };
+
+    struct PendingTopup {
+        int memberId;
+        int duration;
+    };
+
+    BillingJournal();
+    ~BillingJournal();
+
+    // isi file lama dipertahankan untuk recover
+    bool open(const QString& fileName, int capacity);
+    void close();
+    inline bool isOpen() const { return _header != 0; }
+
+    // topup yang hasilnya belum tercatat dikembalikan di topups, per kode voucher
+    void recover(QHash<int, int>* members, QHash<QString, int>* vouchers,
+                 QHash<QString, PendingTopup>* topups) const;
+    // semua record dianggap sudah masuk SQL, file dibuat ulang dengan kapasitas baru
+    bool reset(int capacity);
+
+    // sisa waktu member, atau sisa waktu voucher untuk guest
+    bool append(RecordType type, int clientId, const User& user, const Voucher& voucher);
+    void checkpoint(quint64 sequence);
+    // tidak menunggu disk, record yang berubah disinkronkan di thread JournalSyncer
+    void sync();
+
+    inline quint64 lastSequence() const { return _lastSequence; }
+    quint64 checkpointSequence() const;
+    inline int capacity() const { return _capacity; }
+    inline int pendingCount() const { return int(_lastSequence - checkpointSequence()); }
+    inline quint64 droppedCount() const { return _droppedCount; }
+
+private:
+    struct Header;
+    struct Record;
+
+    bool map();
+    Record* slot(quint64 sequence) const;
+
+    QFile _file;
+    Header* _header;
+    Record* _records;
+    int _capacity;
+    quint64 _lastSequence;
+    quint64 _syncedSequence;
+    quint64 _droppedCount;
+    JournalSyncer _syncer;
+};
+
+}
+
+#endif // BILLINGJOURNAL_H
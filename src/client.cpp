@@ -1,18 +1,17 @@
 #include "client.h"
+#include "timingwheel.h"
 #include <QVariantMap>
 
 using namespace shiftnet;
 
-Client::Client(QObject *parent)
+Client::Client(TimingWheel* timingWheel, QObject *parent)
     : QObject(parent)
+    , _timingWheel(timingWheel)
+    , _timerId(0)
     , _socket(0)
     , _id(0)
     , _state(Offline)
 {
-    _timer.setInterval(60 * 1000);
-    _timer.setTimerType(Qt::PreciseTimer);
-    _timer.setSingleShot(false);
-    connect(&_timer, SIGNAL(timeout()), SLOT(updateDuration()));
 }
 
 void Client::topupVoucher(const Voucher& voucher)
@@ -29,7 +28,7 @@ void Client::startGuestSession(const QString& username, const Voucher& voucher)
     _state = Used;
     _user = User::createGuest(username, voucher.duration());
     _activeVoucher = voucher;
-    _timer.start();
+    startSessionTimer();
 }
 
 void Client::startMemberSession(const User& user)
@@ -37,18 +36,48 @@ void Client::startMemberSession(const User& user)
     resetSession();
     _state = Used;
     _user = user;
-    _timer.start();
+    startSessionTimer();
+}
+
+void Client::restoreSession(const User& user, const Voucher& activeVoucher, const QList<Voucher>& vouchers)
+{
+    resetSession();
+    _user = user;
+    _activeVoucher = activeVoucher;
+    for (const Voucher& voucher: vouchers)
+        _vouchers.enqueue(voucher);
+}
+
+void Client::resumeSession()
+{
+    _state = Used;
+    startSessionTimer();
 }
 
 void Client::resetSession()
 {
     _vouchers.clear();
-    _timer.stop();
+    stopSessionTimer();
     _activeVoucher = Voucher();
     _user = User();
     _state = connection() ? Ready : Offline;
 }
 
+void Client::startSessionTimer()
+{
+    stopSessionTimer();
+    _timerId = _timingWheel->schedule(60 * 1000, [this]() { updateDuration(); }, true);
+}
+
+void Client::stopSessionTimer()
+{
+    if (!_timerId)
+        return;
+
+    _timingWheel->cancel(_timerId);
+    _timerId = 0;
+}
+
 void Client::updateDuration()
 {
     _user.addDuration(-1);
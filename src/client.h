@@ -1,16 +1,17 @@
 #ifndef CLIENT_H
 #define CLIENT_H
 
-#include <QTimer>
+#include <QObject>
 #include <QQueue>
 
 #include "user.h"
 #include "voucher.h"
 
-class QWebSocket;
-
 namespace shiftnet {
 
+class TimingWheel;
+class Connection;
+
 class Client : public QObject
 {
     Q_OBJECT
@@ -23,10 +24,10 @@ public:
         Maintenance
     };
 
-    explicit Client(QObject* parent = 0);
+    explicit Client(TimingWheel* timingWheel, QObject* parent = 0);
 
-    inline void setConnection(QWebSocket* socket) { _socket = socket; }
-    inline QWebSocket* connection() const { return _socket; }
+    inline void setConnection(Connection* socket) { _socket = socket; }
+    inline Connection* connection() const { return _socket; }
 
     inline void setId(int id) { _id = id; }
     inline int id() const { return _id; }
@@ -40,11 +41,17 @@ public:
     inline State state() const { return _state; }
     inline User user() const { return _user; }
     inline Voucher activeVoucher() const { return _activeVoucher; }
+    inline QList<Voucher> queuedVouchers() const { return _vouchers; }
+
+    // sesi hasil restore menunggu PC tersambung kembali
+    inline bool hasSuspendedSession() const { return _state == Offline && !_user.isUnknown(); }
 
     void topupVoucher(const Voucher& voucher);
     void startGuestSession(const QString& username, const Voucher& voucher);
     void startMemberSession(const User& user);
     void startAdminstratorSession();
+    void restoreSession(const User& user, const Voucher& activeVoucher, const QList<Voucher>& vouchers);
+    void resumeSession();
     void resetSession();
     void resetConnection();
 
@@ -55,12 +62,14 @@ signals:
     void sessionTimeout(const User& user);
     void sessionUpdated();
 
-private slots:
+private:
+    void startSessionTimer();
+    void stopSessionTimer();
     void updateDuration();
 
-private:
-    QTimer _timer;
-    QWebSocket* _socket;
+    TimingWheel* _timingWheel;
+    quint64 _timerId;
+    Connection* _socket;
 
     int _id;
     State _state;
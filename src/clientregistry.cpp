@@ -0,0 +1,158 @@
+#include "clientregistry.h"
+#include "client.h"
+
+#include <QHostAddress>
+#include <QSqlRecord>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QDebug>
+
+using namespace shiftnet;
+
+ClientRegistry::ClientRegistry(TimingWheel* timingWheel, QObject* parent)
+    : QObject(parent)
+    , _timingWheel(timingWheel)
+{
+}
+
+void ClientRegistry::load(const QList<QSqlRecord>& records)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    int added = 0;
+    int updated = 0;
+    int retired = 0;
+    QSet<int> ids;
+
+    for (const QSqlRecord& record: records) {
+        const int id = record.value("id").toInt();
+        const QString hostAddress = normalizeAddress(record.value("ipAddress").toString());
+        const QString macAddress = normalizeMacAddress(record.value("macAddress").toString());
+        ids.insert(id);
+
+        Client* client = _clientsByIds.value(id);
+        if (client && _retiring.contains(client)) {
+            // muncul lagi sebelum sempat dihapus
+            _retiring.remove(client);
+            client->setHostAddress(QString());
+            client->setMacAddress(QString());
+        }
+
+        if (!client) {
+            client = new Client(_timingWheel, this);
+            client->setId(id);
+            client->setHostAddress(hostAddress);
+            client->setMacAddress(macAddress);
+            _clients.append(client);
+            _clientsByIds.insert(id, client);
+            index(client);
+            added++;
+            emit clientAdded(client);
+            continue;
+        }
+
+        if (client->hostAddress() != hostAddress || client->macAddress() != macAddress) {
+            unindex(client);
+            client->setHostAddress(hostAddress);
+            client->setMacAddress(macAddress);
+            index(client);
+            updated++;
+        }
+    }
+
+    for (Client* client: QList<Client*>(_clients)) {
+        if (ids.contains(client->id()) || _retiring.contains(client))
+            continue;
+
+        // PC yang masih dipakai baru dihapus setelah offline
+        unindex(client);
+        _retiring.insert(client);
+        retired++;
+        retireIfOffline(client);
+    }
+
+    emit loaded(added, updated, retired, timer.elapsed());
+}
+
+Client* ClientRegistry::findById(int id) const
+{
+    return _clientsByIds.value(id);
+}
+
+Client* ClientRegistry::findByAddress(const QHostAddress& address) const
+{
+    return _clientsByAddresses.value(normalizeAddress(address.toString()));
+}
+
+Client* ClientRegistry::findByMacAddress(const QString& macAddress) const
+{
+    return _clientsByMacAddresses.value(normalizeMacAddress(macAddress));
+}
+
+bool ClientRegistry::retireIfOffline(Client* client)
+{
+    if (!_retiring.contains(client) || client->connection() || client->state() != Client::Offline
+            || client->hasSuspendedSession())
+        return false;
+
+    remove(client);
+    return true;
+}
+
+QString ClientRegistry::normalizeAddress(const QString& address)
+{
+    QHostAddress hostAddress(address.trimmed());
+    if (hostAddress.isNull())
+        return address.trimmed().toLower();
+
+    // ::ffff:192.168.1.10 dan 192.168.1.10 dianggap sama
+    bool isIPv4 = false;
+    const quint32 ipv4 = hostAddress.toIPv4Address(&isIPv4);
+    if (isIPv4)
+        return QHostAddress(ipv4).toString();
+
+    hostAddress.setScopeId(QString());
+    return hostAddress.toString().toLower();
+}
+
+QString ClientRegistry::normalizeMacAddress(const QString& macAddress)
+{
+    QString mac;
+    for (const QChar c: macAddress)
+        if (c.isLetterOrNumber())
+            mac.append(c.toUpper());
+    return mac;
+}
+
+void ClientRegistry::index(Client* client)
+{
+    if (!client->hostAddress().isEmpty()) {
+        if (_clientsByAddresses.contains(client->hostAddress()))
+            qWarning() << "Duplicate client address" << client->hostAddress() << "on client" << client->id();
+        _clientsByAddresses.insert(client->hostAddress(), client);
+    }
+
+    if (!client->macAddress().isEmpty())
+        _clientsByMacAddresses.insert(client->macAddress(), client);
+}
+
+void ClientRegistry::unindex(Client* client)
+{
+    if (_clientsByAddresses.value(client->hostAddress()) == client)
+        _clientsByAddresses.remove(client->hostAddress());
+
+    if (_clientsByMacAddresses.value(client->macAddress()) == client)
+        _clientsByMacAddresses.remove(client->macAddress());
+}
+
+void ClientRegistry::remove(Client* client)
+{
+    emit clientRetired(client);
+
+    unindex(client);
+    _retiring.remove(client);
+    _clientsByIds.remove(client->id());
+    _clients.removeOne(client);
+    client->deleteLater();
+}
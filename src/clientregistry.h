@@ -0,0 +1,60 @@
+#ifndef CLIENTREGISTRY_H
+#define CLIENTREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+
+class QHostAddress;
+class QSqlRecord;
+
+namespace shiftnet {
+
+class Client;
+class TimingWheel;
+
+// Daftar PC dari shiftnet_clients, diindeks berdasarkan id, alamat IP dan MAC.
+// Bisa dimuat ulang saat server berjalan tanpa mengganggu sesi yang aktif.
+class ClientRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ClientRegistry(TimingWheel* timingWheel, QObject* parent = 0);
+
+    void load(const QList<QSqlRecord>& records);
+
+    inline const QList<Client*>& clients() const { return _clients; }
+    inline int count() const { return _clients.size(); }
+
+    Client* findById(int id) const;
+    Client* findByAddress(const QHostAddress& address) const;
+    Client* findByMacAddress(const QString& macAddress) const;
+
+    bool retireIfOffline(Client* client);
+
+    static QString normalizeAddress(const QString& address);
+    static QString normalizeMacAddress(const QString& macAddress);
+
+signals:
+    void clientAdded(Client* client);
+    void clientRetired(Client* client);
+    void loaded(int added, int updated, int retired, qint64 elapsed);
+
+private:
+    void index(Client* client);
+    void unindex(Client* client);
+    void remove(Client* client);
+
+    TimingWheel* _timingWheel;
+    QList<Client*> _clients;
+    QHash<int, Client*> _clientsByIds;
+    QHash<QString, Client*> _clientsByAddresses;
+    QHash<QString, Client*> _clientsByMacAddresses;
+    QSet<Client*> _retiring;
+};
+
+}
+
+#endif // CLIENTREGISTRY_H
@@ -0,0 +1,34 @@
+#include "connection.h"
+#include "ioshard.h"
+
+using namespace shiftnet;
+
+Connection::Connection(IoShard* shard, quint64 id, const QHostAddress& peerAddress, QObject* parent)
+    : QObject(parent)
+    , _shard(shard)
+    , _id(id)
+    , _peerAddress(peerAddress)
+    , _backlogged(false)
+    , _received(false)
+    , _format(Frame::Json)
+{
+}
+
+void Connection::setReceived(Frame::Format format)
+{
+    if (_received)
+        return;
+
+    _received = true;
+    _format = format;
+}
+
+void Connection::send(const Frame& frame, const QString& coalesceKey)
+{
+    _shard->send(_id, frame, coalesceKey);
+}
+
+void Connection::close(const QString& reason)
+{
+    _shard->close(_id, reason);
+}
@@ -0,0 +1,47 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <QObject>
+#include <QHostAddress>
+
+#include "frame.h"
+
+namespace shiftnet {
+
+class IoShard;
+
+// Wakil sebuah QWebSocket di thread utama. Socket aslinya hidup di thread
+// IoShard, Server hanya mengirim dan menutup lewat objek ini.
+class Connection : public QObject
+{
+    Q_OBJECT
+
+public:
+    Connection(IoShard* shard, quint64 id, const QHostAddress& peerAddress, QObject* parent = 0);
+
+    inline IoShard* shard() const { return _shard; }
+    inline quint64 id() const { return _id; }
+    inline QHostAddress peerAddress() const { return _peerAddress; }
+
+    inline void setBacklogged(bool backlogged) { _backlogged = backlogged; }
+    inline bool isBacklogged() const { return _backlogged; }
+
+    // format balasan ditentukan pesan pertama, sama seperti di IoShard
+    void setReceived(Frame::Format format);
+    inline Frame::Format format() const { return _format; }
+
+    void send(const Frame& frame, const QString& coalesceKey = QString());
+    void close(const QString& reason);
+
+private:
+    IoShard* _shard;
+    quint64 _id;
+    QHostAddress _peerAddress;
+    bool _backlogged;
+    bool _received;
+    Frame::Format _format;
+};
+
+}
+
+#endif // CONNECTION_H
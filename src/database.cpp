@@ -1,39 +1,459 @@
 #include "database.h"
 #include "user.h"
 #include "voucher.h"
+#include "activity.h"
+#include "metrics.h"
 
 #include <QSqlDatabase>
 #include <QSqlRecord>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QStringList>
 #include <QSettings>
 #include <QDebug>
 #include <QDateTime>
+#include <QThread>
+#include <QThreadStorage>
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QPair>
 
-#define LOG_DB_ERROR(obj) qCritical() << Q_FUNC_INFO << __FILE__ << __LINE__\
-    << "Database Error:" << qPrintable(obj.lastError().text())
+#define LOG_DB_ERROR(obj) logDbError(Q_FUNC_INFO, __FILE__, __LINE__, obj.lastError())
+
+#define QUERY_TIMER(method) \
+    static Metrics::Series* const queryTimerSeries = Metrics::summary("shiftnet_db_query_seconds", \
+                                                                      Metrics::label("method", method)); \
+    MetricsTimer queryTimer(queryTimerSeries)
 
 using namespace shiftnet;
 
+namespace {
+
+void logDbError(const char* function, const char* file, int line, const QSqlError& error)
+{
+    static Metrics::Series* const errors = Metrics::counter("shiftnet_db_errors_total");
+    Metrics::increment(errors);
+
+    qCritical() << function << file << line << "Database Error:" << qPrintable(error.text());
+}
+
+struct ConnectionSettings
+{
+    QString driver;
+    QString host;
+    int port;
+    QString username;
+    QString password;
+    QString schema;
+
+    // hanya untuk QSQLITE
+    QString synchronous;
+    qint64 mmapSize;
+    int busyTimeout;
+};
+
+ConnectionSettings connectionSettings;
+
+// baris per statement multi-row, di bawah batas 999 parameter SQLite sebelum 3.32
+const int MaxBatchRows = 100;
+
+struct PreparedStatement
+{
+    QSqlQuery query;
+    int generation;
+};
+
+// statement dan jumlah baris
+typedef QPair<int, int> StatementKey;
+
+// prepared statement milik koneksi thread ini, disiapkan ulang setelah reconnect
+struct StatementCache
+{
+    inline StatementCache() : generation(0), transaction(false) {}
+    inline ~StatementCache() { qDeleteAll(statements); }
+
+    int generation;
+    // selama transaksi terbuka statement tidak boleh diulang di koneksi baru
+    bool transaction;
+    QHash<StatementKey, PreparedStatement*> statements;
+};
+
+QThreadStorage<StatementCache*> statementCaches;
+QAtomicInteger<quint64> statementCacheHitCount;
+QAtomicInteger<quint64> statementCacheMissCount;
+
+StatementCache* statementCache()
+{
+    if (!statementCaches.hasLocalData())
+        statementCaches.setLocalData(new StatementCache);
+    return statementCaches.localData();
+}
+
+bool isConnectionLost(const QSqlError& error)
+{
+    // 2006: server has gone away, 2013: lost connection (MySQL)
+    return error.type() == QSqlError::ConnectionError
+            || error.nativeErrorCode() == "2006"
+            || error.nativeErrorCode() == "2013";
+}
+
+bool isEmbedded()
+{
+    return connectionSettings.driver == "QSQLITE";
+}
+
+// tabel yang dipakai server, dibuat saat pertama kali dijalankan dengan SQLite.
+// Tanggal disimpan sebagai teks ISO 8601 sehingga bisa dibandingkan langsung.
+const char* const embeddedSchema[] = {
+    "create table if not exists shiftnet_clients ("
+    " id integer primary key,"
+    " name varchar(50),"
+    " ipAddress varchar(45),"
+    " macAddress varchar(17))",
+
+    "create table if not exists shiftnet_members ("
+    " id integer primary key autoincrement,"
+    " username varchar(50) not null unique collate nocase,"
+    " password varchar(100) not null,"
+    " active integer not null default 1,"
+    " remainingDuration integer not null default 0,"
+    " activeClientId integer)",
+
+    "create table if not exists shiftnet_voucher_transactions ("
+    " id integer primary key autoincrement,"
+    " code varchar(20) not null,"
+    " duration integer not null default 0,"
+    " dateTime datetime,"
+    " expirationDateTime datetime not null)",
+
+    "create index if not exists shiftnet_voucher_transactions_expiration"
+    " on shiftnet_voucher_transactions (expirationDateTime)",
+
+    "create table if not exists shiftnet_active_vouchers ("
+    " code varchar(20) primary key collate nocase,"
+    " voucherId integer not null unique,"
+    " lastActiveUsername varchar(50),"
+    " remainingDuration integer not null default 0,"
+    " activeClientId integer)",
+
+    "create index if not exists shiftnet_active_vouchers_client"
+    " on shiftnet_active_vouchers (activeClientId)",
+
+    "create table if not exists shiftnet_activities ("
+    " id integer primary key autoincrement,"
+    " dateTime datetime not null,"
+    " groupId integer,"
+    " clientId integer,"
+    " memberId integer,"
+    " voucherId integer,"
+    " username varchar(50),"
+    " type varchar(50),"
+    " detail text)",
+
+    "create index if not exists shiftnet_activities_datetime"
+    " on shiftnet_activities (dateTime)",
+};
+
+bool createEmbeddedSchema(QSqlDatabase& db)
+{
+    QSqlQuery q(db);
+    for (const char* statement: embeddedSchema) {
+        if (!q.exec(QString::fromLatin1(statement))) {
+            LOG_DB_ERROR(q);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool openConnection(QSqlDatabase& db)
+{
+    if (!db.open()) {
+        LOG_DB_ERROR(db);
+        return false;
+    }
+
+    if (!isEmbedded())
+        return true;
+
+    // WAL: pembaca tidak diblok penulis, setiap thread punya koneksi sendiri
+    const ConnectionSettings& cs = connectionSettings;
+    const QStringList pragmas({
+        "pragma journal_mode=WAL",
+        "pragma synchronous=" + cs.synchronous,
+        QString("pragma mmap_size=%1").arg(cs.mmapSize),
+        QString("pragma busy_timeout=%1").arg(cs.busyTimeout),
+        "pragma temp_store=MEMORY",
+    });
+
+    QSqlQuery q(db);
+    for (const QString& pragma: pragmas)
+        if (!q.exec(pragma))
+            LOG_DB_ERROR(q);
+
+    return true;
+}
+
+QSqlDatabase addConnection(const QString& name)
+{
+    const ConnectionSettings& cs = connectionSettings;
+    QSqlDatabase db = QSqlDatabase::addDatabase(cs.driver, name);
+    db.setHostName(cs.host);
+    db.setPort(cs.port);
+    db.setUserName(cs.username);
+    db.setPassword(cs.password);
+    db.setDatabaseName(cs.schema);
+    return db;
+}
+
+}
+
 void Database::setup(QSettings &settings)
 {
     settings.beginGroup("Databases");
-    QSqlDatabase db = QSqlDatabase::addDatabase(settings.value("main.driver").toString());
-    db.setHostName(settings.value("main.host").toString());
-    db.setPort(settings.value("main.port").toInt());
-    db.setUserName(settings.value("main.username").toString());
-    db.setPassword(settings.value("main.password").toString());
-    db.setDatabaseName(settings.value("main.schema").toString());
+    connectionSettings.driver = settings.value("main.driver").toString();
+    connectionSettings.host = settings.value("main.host").toString();
+    connectionSettings.port = settings.value("main.port").toInt();
+    connectionSettings.username = settings.value("main.username").toString();
+    connectionSettings.password = settings.value("main.password").toString();
+    connectionSettings.schema = settings.value("main.schema").toString();
+    connectionSettings.synchronous = settings.value("main.synchronous", "NORMAL").toString().toUpper();
+    connectionSettings.mmapSize = settings.value("main.mmapSize", 256 * 1024 * 1024).toLongLong();
+    connectionSettings.busyTimeout = settings.value("main.busyTimeout", 5000).toInt();
     settings.endGroup();
+
+    // nilai ini disisipkan langsung ke PRAGMA, tidak bisa memakai bind
+    ConnectionSettings& cs = connectionSettings;
+    if (!QStringList({ "OFF", "NORMAL", "FULL", "EXTRA" }).contains(cs.synchronous)) {
+        qWarning() << "Invalid main.synchronous:" << qPrintable(cs.synchronous) << "- using NORMAL";
+        cs.synchronous = "NORMAL";
+    }
+    if (cs.mmapSize < 0) {
+        qWarning() << "Invalid main.mmapSize:" << cs.mmapSize << "- using 0";
+        cs.mmapSize = 0;
+    }
+    if (cs.busyTimeout < 0) {
+        qWarning() << "Invalid main.busyTimeout:" << cs.busyTimeout << "- using 0";
+        cs.busyTimeout = 0;
+    }
+
+    addConnection(QSqlDatabase::defaultConnection);
+}
+
+QString Database::connectionName()
+{
+    QThread* thread = QThread::currentThread();
+    if (thread == QCoreApplication::instance()->thread())
+        return QSqlDatabase::defaultConnection;
+
+    return QString("shiftnet-%1").arg(quintptr(thread), 0, 16);
+}
+
+QSqlDatabase Database::connection()
+{
+    // setiap thread memakai koneksi sendiri, QSqlDatabase tidak boleh dipakai lintas thread
+    const QString name = connectionName();
+    if (QSqlDatabase::contains(name)) {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        if (!db.isOpen())
+            openConnection(db);
+        return db;
+    }
+
+    QSqlDatabase db = addConnection(name);
+    openConnection(db);
+
+    return db;
+}
+
+void Database::closeConnection()
+{
+    // query yang masih memakai koneksi harus dihapus lebih dulu
+    statementCaches.setLocalData(0);
+
+    const QString name = connectionName();
+    if (!QSqlDatabase::contains(name))
+        return;
+
+    {
+        QSqlDatabase db = QSqlDatabase::database(name, false);
+        db.close();
+    }
+
+    // koneksi utama tetap terdaftar, dibuka lagi otomatis jika dibutuhkan
+    if (name != QSqlDatabase::defaultConnection)
+        QSqlDatabase::removeDatabase(name);
+}
+
+quint64 Database::statementCacheHits()
+{
+    return statementCacheHitCount.load();
+}
+
+quint64 Database::statementCacheMisses()
+{
+    return statementCacheMissCount.load();
+}
+
+QString Database::statementText(Statement statement, int rows)
+{
+    QString text;
+
+    switch (statement) {
+    case SelectClients:
+        return "select * from shiftnet_clients order by id asc";
+    case DeleteExpiredVouchers:
+        return "delete from shiftnet_active_vouchers"
+               " where voucherId in (select id from shiftnet_voucher_transactions where expirationDateTime < ?)";
+    case DeleteVouchersByIds:
+        for (int i = 0; i < rows; i++)
+            text += i ? ",?" : "?";
+
+        // voucher yang sedang dipakai dibiarkan sampai sesinya selesai
+        return "delete from shiftnet_active_vouchers"
+               " where voucherId in (" + text + ") and activeClientId is null";
+    case DeleteVoucher:
+        return "delete from shiftnet_active_vouchers where code=?";
+    case UpdateMemberDuration:
+        return "update shiftnet_members set remainingDuration=? where id=?";
+    case UpdateVoucherDuration:
+        return "update shiftnet_active_vouchers set remainingDuration=? where code=?";
+    case UpdateMemberDurations:
+    case UpdateVoucherDurations: {
+        QString cases;
+        QString keys;
+        for (int i = 0; i < rows; i++) {
+            cases += " when ? then ?";
+            keys += i ? ",?" : "?";
+        }
+
+        if (statement == UpdateMemberDurations)
+            return "update shiftnet_members set remainingDuration=case id" + cases + " end"
+                   " where id in (" + keys + ")";
+
+        return "update shiftnet_active_vouchers set remainingDuration=case code" + cases + " end"
+               " where code in (" + keys + ")";
+    }
+    case ResetVoucherClientState:
+        return "update shiftnet_active_vouchers set activeClientId=null where activeClientId=?";
+    case ReleaseVoucher:
+        return "update shiftnet_active_vouchers set activeClientId=null where code=? and activeClientId=?";
+    case ResetMemberClientState:
+        return "update shiftnet_members set activeClientId=null where id=?";
+    case ReleaseMember:
+        return "update shiftnet_members set activeClientId=null where id=? and activeClientId=?";
+    case ResetVoucherClientStates:
+    case ResetMemberClientStates:
+        for (int i = 0; i < rows; i++)
+            text += i ? ",?" : "?";
+
+        if (statement == ResetVoucherClientStates)
+            return "update shiftnet_active_vouchers set activeClientId=null where activeClientId in (" + text + ")";
+
+        return "update shiftnet_members set activeClientId=null where id in (" + text + ")";
+    case FindVoucher:
+        return "select a.code, a.lastActiveUsername, a.remainingDuration, a.activeClientId, t.id, t.expirationDateTime"
+               " from shiftnet_active_vouchers a"
+               " inner join shiftnet_voucher_transactions t on t.id = a.voucherId"
+               " where a.code=?";
+    case SelectActiveVouchers:
+        return "select a.code, a.lastActiveUsername, a.remainingDuration, a.activeClientId, t.id, t.expirationDateTime"
+               " from shiftnet_active_vouchers a"
+               " inner join shiftnet_voucher_transactions t on t.id = a.voucherId"
+               " where a.voucherId > ?"
+               " order by a.voucherId asc limit ?";
+    case UseVoucher:
+        // voucher bisa sudah dipakai client lain sejak divalidasi
+        return "update shiftnet_active_vouchers set activeClientId=?, lastActiveUsername=?"
+               " where code=? and (activeClientId is null or activeClientId=?)";
+    case FindMember:
+        return "select id, username, password, active, remainingDuration, activeClientId"
+               " from shiftnet_members where username=?";
+    case SetMemberClientId:
+        return "update shiftnet_members set activeClientId=? where id=? and activeClientId is null";
+    case InsertActivities:
+        for (int i = 0; i < rows; i++)
+            text += i ? ",(?,?,?,?,?,?,?,?)" : "(?,?,?,?,?,?,?,?)";
+
+        return "insert into shiftnet_activities"
+               "( dateTime, groupId, clientId, memberId, voucherId, username, type, detail)"
+               " values " + text;
+    }
+
+    return text;
+}
+
+QSqlQuery& Database::prepare(Statement statement, int rows)
+{
+    StatementCache* cache = statementCache();
+    const StatementKey key(statement, rows);
+
+    PreparedStatement* prepared = cache->statements.value(key);
+    if (prepared && prepared->generation == cache->generation) {
+        statementCacheHitCount.fetchAndAddRelaxed(1);
+        return prepared->query;
+    }
+
+    statementCacheMissCount.fetchAndAddRelaxed(1);
+
+    if (!prepared) {
+        prepared = new PreparedStatement;
+        cache->statements.insert(key, prepared);
+    }
+
+    prepared->query = QSqlQuery(connection());
+    prepared->generation = cache->generation;
+    if (!prepared->query.prepare(statementText(statement, rows)))
+        LOG_DB_ERROR(prepared->query);
+
+    return prepared->query;
+}
+
+bool Database::exec(QSqlQuery& q)
+{
+    if (q.exec())
+        return true;
+
+    if (!isConnectionLost(q.lastError()))
+        return false;
+
+    StatementCache* cache = statementCache();
+    QSqlDatabase db = connection();
+    db.close();
+    cache->generation++;
+
+    // statement sebelumnya dalam transaksi ikut hilang, pemanggil harus rollback
+    // dan mengulang seluruh transaksi. Koneksi dibuka lagi oleh query berikutnya.
+    if (cache->transaction)
+        return false;
+
+    // koneksi putus, buka lagi lalu siapkan ulang statement ini dengan nilai yang sama
+    if (!openConnection(db))
+        return false;
+
+    const QString text = q.lastQuery();
+    QVariantList values;
+    for (int i = 0; i < q.boundValues().size(); i++)
+        values << q.boundValue(i);
+
+    q = QSqlQuery(db);
+    if (!q.prepare(text))
+        return false;
+
+    for (int i = 0; i < values.size(); i++)
+        q.bindValue(i, values.at(i));
+
+    return q.exec();
 }
 
 QList<QSqlRecord> Database::clients()
 {
+    QUERY_TIMER("clients");
     QList<QSqlRecord> clients;
 
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("select * from shiftnet_clients order by id asc");
-    if (!q.exec()) {
+    QSqlQuery& q = prepare(SelectClients);
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return clients;
     }
@@ -41,12 +461,14 @@ QList<QSqlRecord> Database::clients()
     while (q.next())
         clients << q.record();
 
+    q.finish();
     return clients;
 }
 
 bool Database::init()
 {
-    QSqlDatabase db = QSqlDatabase::database();
+    QUERY_TIMER("init");
+    QSqlDatabase db = connection();
     QSqlQuery q(db);
 
     if (!db.isOpen()) {
@@ -54,77 +476,50 @@ bool Database::init()
         return false;
     }
 
-    QList<quint64> expiredVoucherIds;
-    q.prepare("select"
-              " t.id, t.expirationDateTime"
-              " from shiftnet_active_vouchers a"
-              " inner join shiftnet_voucher_transactions t"
-              "   on t.id = a.voucherId");
-
-    if (!q.exec()) {
-        LOG_DB_ERROR(db);
+    if (isEmbedded() && !createEmbeddedSchema(db))
         return false;
-    }
-
-    QDateTime now = QDateTime::currentDateTime();
-    while (q.next()) {
-        QDateTime dateTime = q.value("expirationDateTime").toDateTime();
-
-        if (dateTime < now) {
-            expiredVoucherIds << q.value("id").value<quint64>();
-        }
-    }
 
-    if (!db.transaction()) {
-        LOG_DB_ERROR(db);
+    if (!transaction())
         return false;
-    }
 
     // reset activeClientId
     if (!q.exec("update shiftnet_members set activeClientId=null where 1")) {
         LOG_DB_ERROR(q);
-        db.rollback();
+        rollback();
         return false;
     }
 
     // delete empty duration voucher
-    q.prepare("delete from shiftnet_active_vouchers where remainingDuration<=0");
-    if (!q.exec()) {
+    if (!q.exec("delete from shiftnet_active_vouchers where remainingDuration<=0")) {
         LOG_DB_ERROR(q);
-        db.rollback();
+        rollback();
         return false;
     }
 
     // delete expired vouchers
-    for (quint64 voucherId: expiredVoucherIds) {
-        q.prepare("delete from shiftnet_active_vouchers where voucherId=?");
-        q.bindValue(0, voucherId);
-        if (!q.exec()) {
-            LOG_DB_ERROR(q);
-            db.rollback();
-            return false;
-        }
+    QSqlQuery& deleteExpired = prepare(DeleteExpiredVouchers);
+    deleteExpired.bindValue(0, QDateTime::currentDateTime());
+    if (!exec(deleteExpired)) {
+        LOG_DB_ERROR(deleteExpired);
+        rollback();
+        return false;
     }
 
     if (!q.exec("update shiftnet_active_vouchers set activeClientId=null where 1")) {
         LOG_DB_ERROR(q);
+        rollback();
         return false;
     }
 
-    if (!db.commit()) {
-        LOG_DB_ERROR(db);
-        return false;
-    }
-
-    return true;
+    return commit();
 }
 
 bool Database::deleteVoucher(const QString &code)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("delete from shiftnet_active_vouchers where code=?");
+    QUERY_TIMER("deleteVoucher");
+    QSqlQuery& q = prepare(DeleteVoucher);
     q.bindValue(0, code);
-    if (!q.exec()) {
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return false;
     }
@@ -132,15 +527,38 @@ bool Database::deleteVoucher(const QString &code)
     return q.numRowsAffected() > 0;
 }
 
-bool Database::updateMemberDuration(int id, int duration)
+int Database::deleteExpiredVouchers(const QList<quint64>& voucherIds)
 {
-    QSqlQuery q(QSqlDatabase::database());
+    QUERY_TIMER("deleteExpiredVouchers");
+    if (voucherIds.isEmpty())
+        return 0;
+
+    int deleted = 0;
+    for (int first = 0; first < voucherIds.size(); first += MaxBatchRows) {
+        const int rows = qMin(voucherIds.size() - first, MaxBatchRows);
+        QSqlQuery& q = prepare(DeleteVouchersByIds, rows);
+        for (int i = 0; i < rows; i++)
+            q.bindValue(i, voucherIds.at(first + i));
+
+        if (!exec(q)) {
+            LOG_DB_ERROR(q);
+            return -1;
+        }
+
+        deleted += q.numRowsAffected();
+    }
+
+    return deleted;
+}
 
-    q.prepare("update shiftnet_members set remainingDuration=? where id=?");
+bool Database::updateMemberDuration(int id, int duration)
+{
+    QUERY_TIMER("updateMemberDuration");
+    QSqlQuery& q = prepare(UpdateMemberDuration);
     q.bindValue(0, duration);
     q.bindValue(1, id);
 
-    if (!q.exec()) {
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return false;
     }
@@ -150,13 +568,12 @@ bool Database::updateMemberDuration(int id, int duration)
 
 bool Database::updateVoucherDuration(const QString& code, int duration)
 {
-    QSqlQuery q(QSqlDatabase::database());
-
-    q.prepare("update shiftnet_active_vouchers set remainingDuration=? where code=?");
+    QUERY_TIMER("updateVoucherDuration");
+    QSqlQuery& q = prepare(UpdateVoucherDuration);
     q.bindValue(0, duration);
     q.bindValue(1, code);
 
-    if (!q.exec()) {
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return false;
     }
@@ -164,12 +581,86 @@ bool Database::updateVoucherDuration(const QString& code, int duration)
     return q.numRowsAffected() > 0;
 }
 
+bool Database::updateMemberDurations(const QHash<int, int>& durations)
+{
+    QUERY_TIMER("updateMemberDurations");
+    int remaining = durations.size();
+    QHash<int, int>::const_iterator it = durations.constBegin();
+
+    while (remaining > 0) {
+        const int rows = qMin(remaining, MaxBatchRows);
+        QSqlQuery& q = prepare(UpdateMemberDurations, rows);
+
+        int i = 0;
+        QHash<int, int>::const_iterator key = it;
+        for (int row = 0; row < rows; row++, ++it) {
+            q.bindValue(i++, it.key());
+            q.bindValue(i++, it.value());
+        }
+        for (int row = 0; row < rows; row++, ++key)
+            q.bindValue(i++, key.key());
+
+        if (!exec(q)) {
+            LOG_DB_ERROR(q);
+            return false;
+        }
+
+        remaining -= rows;
+    }
+
+    return true;
+}
+
+bool Database::updateVoucherDurations(const QHash<QString, int>& durations)
+{
+    QUERY_TIMER("updateVoucherDurations");
+    int remaining = durations.size();
+    QHash<QString, int>::const_iterator it = durations.constBegin();
+
+    while (remaining > 0) {
+        const int rows = qMin(remaining, MaxBatchRows);
+        QSqlQuery& q = prepare(UpdateVoucherDurations, rows);
+
+        int i = 0;
+        QHash<QString, int>::const_iterator key = it;
+        for (int row = 0; row < rows; row++, ++it) {
+            q.bindValue(i++, it.key());
+            q.bindValue(i++, it.value());
+        }
+        for (int row = 0; row < rows; row++, ++key)
+            q.bindValue(i++, key.key());
+
+        if (!exec(q)) {
+            LOG_DB_ERROR(q);
+            return false;
+        }
+
+        remaining -= rows;
+    }
+
+    return true;
+}
+
 bool Database::resetVoucherClientState(int id)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("update shiftnet_active_vouchers set activeClientId=null where activeClientId=?");
+    QUERY_TIMER("resetVoucherClientState");
+    QSqlQuery& q = prepare(ResetVoucherClientState);
     q.bindValue(0, id);
-    if (!q.exec()) {
+    if (!exec(q)) {
+        LOG_DB_ERROR(q);
+        return false;
+    }
+
+    return q.numRowsAffected();
+}
+
+bool Database::releaseVoucher(const QString& code, int clientId)
+{
+    QUERY_TIMER("releaseVoucher");
+    QSqlQuery& q = prepare(ReleaseVoucher);
+    q.bindValue(0, code);
+    q.bindValue(1, clientId);
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return false;
     }
@@ -179,10 +670,24 @@ bool Database::resetVoucherClientState(int id)
 
 bool Database::resetMemberClientState(int memberId)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("update shiftnet_members set activeClientId=null where id=?");
+    QUERY_TIMER("resetMemberClientState");
+    QSqlQuery& q = prepare(ResetMemberClientState);
+    q.bindValue(0, memberId);
+    if (!exec(q)) {
+        LOG_DB_ERROR(q);
+        return false;
+    }
+
+    return q.numRowsAffected();
+}
+
+bool Database::releaseMember(int memberId, int clientId)
+{
+    QUERY_TIMER("releaseMember");
+    QSqlQuery& q = prepare(ReleaseMember);
     q.bindValue(0, memberId);
-    if (!q.exec()) {
+    q.bindValue(1, clientId);
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return false;
     }
@@ -190,34 +695,91 @@ bool Database::resetMemberClientState(int memberId)
     return q.numRowsAffected();
 }
 
+bool Database::resetVoucherClientStates(const QList<int>& clientIds)
+{
+    QUERY_TIMER("resetVoucherClientStates");
+    for (int first = 0; first < clientIds.size(); first += MaxBatchRows) {
+        const int rows = qMin(clientIds.size() - first, MaxBatchRows);
+        QSqlQuery& q = prepare(ResetVoucherClientStates, rows);
+        for (int i = 0; i < rows; i++)
+            q.bindValue(i, clientIds.at(first + i));
+
+        if (!exec(q)) {
+            LOG_DB_ERROR(q);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool Database::resetMemberClientStates(const QList<int>& memberIds)
+{
+    QUERY_TIMER("resetMemberClientStates");
+    for (int first = 0; first < memberIds.size(); first += MaxBatchRows) {
+        const int rows = qMin(memberIds.size() - first, MaxBatchRows);
+        QSqlQuery& q = prepare(ResetMemberClientStates, rows);
+        for (int i = 0; i < rows; i++)
+            q.bindValue(i, memberIds.at(first + i));
+
+        if (!exec(q)) {
+            LOG_DB_ERROR(q);
+            return false;
+        }
+    }
+
+    return true;
+}
+
 QSqlRecord Database::findVoucher(const QString &code)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("select a.code, a.lastActiveUsername, a.remainingDuration, a.activeClientId, t.id, t.expirationDateTime"
-              " from shiftnet_active_vouchers a"
-              " inner join shiftnet_voucher_transactions t on t.id = a.voucherId"
-              " where a.code=?");
+    QUERY_TIMER("findVoucher");
+    QSqlQuery& q = prepare(FindVoucher);
     q.bindValue(0, code);
-    if (!q.exec()) {
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return QSqlRecord();
     }
 
     if (!q.next()) {
+        q.finish();
         return QSqlRecord();
     }
 
-    return q.record();
+    const QSqlRecord record = q.record();
+    q.finish();
+    return record;
+}
+
+QList<QSqlRecord> Database::activeVouchers(quint64 afterVoucherId, int limit)
+{
+    QUERY_TIMER("activeVouchers");
+    QList<QSqlRecord> vouchers;
+
+    QSqlQuery& q = prepare(SelectActiveVouchers);
+    q.bindValue(0, afterVoucherId);
+    q.bindValue(1, limit);
+    if (!exec(q)) {
+        LOG_DB_ERROR(q);
+        return vouchers;
+    }
+
+    while (q.next())
+        vouchers << q.record();
+
+    q.finish();
+    return vouchers;
 }
 
 bool Database::useVoucher(const QString &code, int clientId, const QString& username)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("update shiftnet_active_vouchers set activeClientId=?, lastActiveUsername=? where code=?");
+    QUERY_TIMER("useVoucher");
+    QSqlQuery& q = prepare(UseVoucher);
     q.bindValue(0, clientId);
     q.bindValue(1, username);
     q.bindValue(2, code);
-    if (!q.exec()) {
+    q.bindValue(3, clientId);
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return false;
     }
@@ -227,54 +789,99 @@ bool Database::useVoucher(const QString &code, int clientId, const QString& user
 
 bool Database::topupMemberVoucher(int userId, int memberDuration, const QString &voucherCode, int voucherDuration)
 {
-    QSqlDatabase db = QSqlDatabase::database();
-    db.transaction();
-    if (!updateMemberDuration(userId, memberDuration + voucherDuration)) {
-        db.rollback();
+    QUERY_TIMER("topupMemberVoucher");
+    if (!transaction())
         return false;
-    }
 
-    if (!deleteVoucher(voucherCode)) {
-        db.rollback();
+    if (!updateMemberDuration(userId, memberDuration + voucherDuration)) {
+        rollback();
         return false;
     }
 
-    if (!db.commit()) {
-        LOG_DB_ERROR(db);
-        db.rollback();
+    if (!deleteVoucher(voucherCode)) {
+        rollback();
         return false;
     }
 
-    return true;
+    return commit();
 }
 
 QSqlRecord Database::findMember(const QString &username)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("select id, username, password, active, remainingDuration, activeClientId"
-              " from shiftnet_members where username=?");
+    QUERY_TIMER("findMember");
+    QSqlQuery& q = prepare(FindMember);
     q.bindValue(0, username);
-    if (!q.exec()) {
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
         return QSqlRecord();
     }
 
-    if (!q.next()) return QSqlRecord();
+    if (!q.next()) {
+        q.finish();
+        return QSqlRecord();
+    }
 
-    return q.record();
+    const QSqlRecord record = q.record();
+    q.finish();
+    return record;
 }
 
-bool Database::setMemberClientId(int memberId, int clientId)
+Database::ClaimResult Database::setMemberClientId(int memberId, int clientId)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("update shiftnet_members set activeClientId=? where id=?");
+    QUERY_TIMER("setMemberClientId");
+    QSqlQuery& q = prepare(SetMemberClientId);
     q.bindValue(0, clientId);
     q.bindValue(1, memberId);
-    if (!q.exec()) {
+    if (!exec(q)) {
         LOG_DB_ERROR(q);
+        return ClaimFailed;
+    }
+    return q.numRowsAffected() > 0 ? Claimed : ClaimTaken;
+}
+
+bool Database::restoreClientState(int clientId, const User& user, const QList<Voucher>& vouchers)
+{
+    QUERY_TIMER("restoreClientState");
+    if (!transaction())
         return false;
+
+    bool ok = true;
+    if (user.isMember()) {
+        ok = setMemberClientId(user.id(), clientId) == Claimed;
     }
-    return true;
+    else {
+        for (const Voucher& voucher: vouchers)
+            ok = ok && useVoucher(voucher.code(), clientId, user.username());
+    }
+
+    if (!ok) {
+        rollback();
+        return false;
+    }
+
+    return commit();
+}
+
+bool Database::stopSessions(const QHash<int, int>& memberDurations, const QHash<QString, int>& voucherDurations,
+                            const QList<int>& clientIds, const QList<int>& memberIds,
+                            const QList<Activity>& activities)
+{
+    QUERY_TIMER("stopSessions");
+    if (!transaction())
+        return false;
+
+    bool ok = updateMemberDurations(memberDurations)
+            && updateVoucherDurations(voucherDurations)
+            && resetVoucherClientStates(clientIds)
+            && resetMemberClientStates(memberIds)
+            && logUserActivities(activities);
+
+    if (!ok) {
+        rollback();
+        return false;
+    }
+
+    return commit();
 }
 
 bool Database::topupVoucher(int clientId, const User& user, const Voucher& voucher)
@@ -290,40 +897,68 @@ bool Database::topupVoucher(int clientId, const User& user, const Voucher& vouch
 
 bool Database::logUserActivity(int clientId, const User& user, const QString& activity, const QString &text, quint64 voucherId)
 {
-    QSqlQuery q(QSqlDatabase::database());
-    q.prepare("insert into shiftnet_activities"
-              "( dateTime, groupId, clientId, memberId, voucherId, username, type, detail)"
-              " values "
-              "(:dateTime,:groupId,:clientId,:memberId,:voucherId,:username,:type,:detail)");
-    q.bindValue(":dateTime", QDateTime::currentDateTime());
-    q.bindValue(":clientId", clientId);
-    q.bindValue(":memberId", user.isMember() ? user.id() : QVariant());
-    q.bindValue(":voucherId", voucherId ? voucherId : QVariant());
-    q.bindValue(":groupId", user.group());
-    q.bindValue(":username", user.username());
-    q.bindValue(":type", activity);
-    q.bindValue(":detail", text);
-
-    if (!q.exec()) {
-        LOG_DB_ERROR(q);
-        return false;
+    return logUserActivities(QList<Activity>() << Activity(clientId, user, activity, text, voucherId));
+}
+
+bool Database::logUserActivities(const QList<Activity>& activities)
+{
+    QUERY_TIMER("logUserActivities");
+    for (int first = 0; first < activities.size(); first += MaxBatchRows) {
+        const int rows = qMin(activities.size() - first, MaxBatchRows);
+        QSqlQuery& q = prepare(InsertActivities, rows);
+
+        int i = 0;
+        for (int row = 0; row < rows; row++) {
+            const Activity& activity = activities.at(first + row);
+            const User user = activity.user();
+            q.bindValue(i++, activity.dateTime());
+            q.bindValue(i++, user.group());
+            q.bindValue(i++, activity.clientId());
+            q.bindValue(i++, user.isMember() ? user.id() : QVariant());
+            q.bindValue(i++, activity.voucherId() ? activity.voucherId() : QVariant());
+            q.bindValue(i++, user.username());
+            q.bindValue(i++, activity.type());
+            q.bindValue(i++, activity.detail());
+        }
+
+        if (!exec(q)) {
+            LOG_DB_ERROR(q);
+            return false;
+        }
     }
     return true;
 }
 
 bool Database::transaction()
 {
-    QSqlDatabase db = QSqlDatabase::database();
-    if (!db.transaction()) {
+    QUERY_TIMER("transaction");
+    StatementCache* cache = statementCache();
+    QSqlDatabase db = connection();
+
+    bool ok = db.transaction();
+
+    // belum ada statement di transaksi ini, aman dibuka di koneksi baru
+    if (!ok && isConnectionLost(db.lastError())) {
+        db.close();
+        cache->generation++;
+        ok = openConnection(db) && db.transaction();
+    }
+
+    if (!ok) {
         LOG_DB_ERROR(db);
         return false;
     }
+
+    cache->transaction = true;
     return true;
 }
 
 bool Database::commit()
 {
-    QSqlDatabase db = QSqlDatabase::database();
+    QUERY_TIMER("commit");
+    statementCache()->transaction = false;
+
+    QSqlDatabase db = connection();
     if (!db.commit()) {
         LOG_DB_ERROR(db);
         db.rollback();
@@ -331,3 +966,13 @@ bool Database::commit()
     }
     return true;
 }
+
+void Database::rollback()
+{
+    QUERY_TIMER("rollback");
+    statementCache()->transaction = false;
+
+    QSqlDatabase db = connection();
+    if (!db.rollback())
+        LOG_DB_ERROR(db);
+}
@@ -2,46 +2,105 @@
 #define DATABASE_H
 
 #include <QtGlobal>
+#include <QHash>
 
 class QSettings;
 class QString;
 class QSqlRecord;
+class QSqlDatabase;
+class QSqlQuery;
 
 namespace shiftnet {
 
 class User;
 class Voucher;
+class Activity;
 
 class Database
 {
 public:
+    // ClaimTaken berarti member sedang dipakai PC lain, bukan kesalahan database
+    enum ClaimResult {
+        ClaimFailed,
+        ClaimTaken,
+        Claimed
+    };
+
     static void setup(QSettings& settings);
     static bool init();
 
+    static QSqlDatabase connection();
+    static void closeConnection();
+
     static bool transaction();
     static bool commit();
+    static void rollback();
 
     static bool topupVoucher(int clientId, const User& user, const Voucher& voucher);
 
     static bool useVoucher(const QString& code, int clientId, const QString& username);
     static bool deleteVoucher(const QString& code);
+    static int deleteExpiredVouchers(const QList<quint64>& voucherIds);
     static bool updateMemberDuration(int memberId, int duration);
     static bool updateVoucherDuration(const QString& code, int duration);
+    static bool updateMemberDurations(const QHash<int, int>& durations);
+    static bool updateVoucherDurations(const QHash<QString, int>& durations);
     static bool resetVoucherClientState(int clientId);
+    static bool releaseVoucher(const QString& code, int clientId);
     static bool resetMemberClientState(int memberId);
-    static bool setMemberClientId(int memberId, int clientId);
+    static bool releaseMember(int memberId, int clientId);
+    static bool resetVoucherClientStates(const QList<int>& clientIds);
+    static bool resetMemberClientStates(const QList<int>& memberIds);
+    static ClaimResult setMemberClientId(int memberId, int clientId);
+    static bool restoreClientState(int clientId, const User& user, const QList<Voucher>& vouchers);
+    static bool stopSessions(const QHash<int, int>& memberDurations, const QHash<QString, int>& voucherDurations,
+                             const QList<int>& clientIds, const QList<int>& memberIds,
+                             const QList<Activity>& activities);
 
     static bool topupMemberVoucher(int userId, int memberDuration,
                                    const QString& voucherCode, int duration);
 
     static QSqlRecord findVoucher(const QString& code);
+    static QList<QSqlRecord> activeVouchers(quint64 afterVoucherId, int limit);
     static QSqlRecord findMember(const QString& username);
     static QList<QSqlRecord> clients();
 
     static bool logUserActivity(int clientId, const User& user, const QString& activity, const QString &text, quint64 voucherId = 0);
+    static bool logUserActivities(const QList<Activity>& activities);
+
+    static quint64 statementCacheHits();
+    static quint64 statementCacheMisses();
 
 private:
+    enum Statement {
+        SelectClients,
+        DeleteExpiredVouchers,
+        DeleteVouchersByIds,
+        DeleteVoucher,
+        UpdateMemberDuration,
+        UpdateVoucherDuration,
+        UpdateMemberDurations,
+        UpdateVoucherDurations,
+        ResetVoucherClientState,
+        ReleaseVoucher,
+        ResetMemberClientState,
+        ReleaseMember,
+        ResetVoucherClientStates,
+        ResetMemberClientStates,
+        FindVoucher,
+        SelectActiveVouchers,
+        UseVoucher,
+        FindMember,
+        SetMemberClientId,
+        InsertActivities
+    };
+
     Database();
+
+    static QString connectionName();
+    static QString statementText(Statement statement, int rows);
+    static QSqlQuery& prepare(Statement statement, int rows = 1);
+    static bool exec(QSqlQuery& q);
 };
 
 }
@@ -0,0 +1,109 @@
+#include "databaseexecutor.h"
+#include "database.h"
+#include "user.h"
+#include "voucher.h"
+#include "activity.h"
+
+using namespace shiftnet;
+
+DatabaseExecutor::DatabaseExecutor(QObject* parent)
+    : QObject(parent)
+    , _worker(new QObject)
+{
+    _thread.setObjectName("database");
+    _worker->moveToThread(&_thread);
+    connect(&_thread, SIGNAL(finished()), _worker, SLOT(deleteLater()));
+}
+
+DatabaseExecutor::~DatabaseExecutor()
+{
+    stop();
+}
+
+void DatabaseExecutor::start()
+{
+    _thread.start();
+}
+
+void DatabaseExecutor::stop()
+{
+    if (!_thread.isRunning())
+        return;
+
+    // job terakhir, semua job sebelumnya sudah dijalankan
+    post([]() {
+        Database::closeConnection();
+        QThread::currentThread()->quit();
+    });
+
+    _thread.wait();
+}
+
+void DatabaseExecutor::findVoucher(const QString& code, QObject* context, const RecordCallback& callback)
+{
+    post([code]() { return Database::findVoucher(code); }, context, callback);
+}
+
+void DatabaseExecutor::findMember(const QString& username, QObject* context, const RecordCallback& callback)
+{
+    post([username]() { return Database::findMember(username); }, context, callback);
+}
+
+void DatabaseExecutor::useVoucher(const QString& code, int clientId, const QString& username,
+                                  QObject* context, const BoolCallback& callback)
+{
+    post([code, clientId, username]() { return Database::useVoucher(code, clientId, username); }, context, callback);
+}
+
+void DatabaseExecutor::deleteVoucher(const QString& code, QObject* context, const BoolCallback& callback)
+{
+    post([code]() { return Database::deleteVoucher(code); }, context, callback);
+}
+
+void DatabaseExecutor::topupVoucher(int clientId, const User& user, const Voucher& voucher,
+                                    QObject* context, const BoolCallback& callback)
+{
+    post([clientId, user, voucher]() { return Database::topupVoucher(clientId, user, voucher); }, context, callback);
+}
+
+void DatabaseExecutor::topupMemberVoucher(int userId, int memberDuration, const QString& voucherCode, int duration,
+                                          QObject* context, const BoolCallback& callback)
+{
+    post([userId, memberDuration, voucherCode, duration]() {
+        return Database::topupMemberVoucher(userId, memberDuration, voucherCode, duration);
+    }, context, callback);
+}
+
+void DatabaseExecutor::setMemberClientId(int memberId, int clientId, QObject* context, const ClaimCallback& callback)
+{
+    post([memberId, clientId]() { return Database::setMemberClientId(memberId, clientId); }, context, callback);
+}
+
+void DatabaseExecutor::resetMemberClientState(int memberId, QObject* context, const BoolCallback& callback)
+{
+    post([memberId]() { return Database::resetMemberClientState(memberId); }, context, callback);
+}
+
+void DatabaseExecutor::releaseMember(int memberId, int clientId, QObject* context, const BoolCallback& callback)
+{
+    post([memberId, clientId]() { return Database::releaseMember(memberId, clientId); }, context, callback);
+}
+
+void DatabaseExecutor::resetVoucherClientState(int clientId, QObject* context, const BoolCallback& callback)
+{
+    post([clientId]() { return Database::resetVoucherClientState(clientId); }, context, callback);
+}
+
+void DatabaseExecutor::releaseVoucher(const QString& code, int clientId, QObject* context, const BoolCallback& callback)
+{
+    post([code, clientId]() { return Database::releaseVoucher(code, clientId); }, context, callback);
+}
+
+void DatabaseExecutor::stopSessions(const QHash<int, int>& memberDurations, const QHash<QString, int>& voucherDurations,
+                                    const QList<int>& clientIds, const QList<int>& memberIds,
+                                    const QList<Activity>& activities, QObject* context, const BoolCallback& callback)
+{
+    post([memberDurations, voucherDurations, clientIds, memberIds, activities]() {
+        return Database::stopSessions(memberDurations, voucherDurations, clientIds, memberIds, activities);
+    }, context, callback);
+}
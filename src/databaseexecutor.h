@@ -0,0 +1,108 @@
+#ifndef DATABASEEXECUTOR_H
+#define DATABASEEXECUTOR_H
+
+#include <QObject>
+#include <QThread>
+#include <QPointer>
+#include <QSqlRecord>
+#include <QHash>
+
+#include <functional>
+
+#include "database.h"
+#include "metrics.h"
+
+namespace shiftnet {
+
+class User;
+class Voucher;
+class Activity;
+
+// Menjalankan query Database di thread sendiri dengan koneksi sendiri.
+// Job dijalankan berurutan, hasilnya dikirim kembali ke thread milik context
+// dan dibuang jika context sudah dihapus.
+class DatabaseExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(bool)> BoolCallback;
+    typedef std::function<void(const QSqlRecord&)> RecordCallback;
+    typedef std::function<void(Database::ClaimResult)> ClaimCallback;
+
+    explicit DatabaseExecutor(QObject* parent = 0);
+    ~DatabaseExecutor();
+
+    void start();
+    void stop();
+
+    template <typename Job>
+    void post(Job job);
+
+    template <typename Job, typename Callback>
+    void post(Job job, QObject* context, Callback callback);
+
+    void findVoucher(const QString& code, QObject* context, const RecordCallback& callback);
+    void findMember(const QString& username, QObject* context, const RecordCallback& callback);
+
+    void useVoucher(const QString& code, int clientId, const QString& username,
+                    QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void deleteVoucher(const QString& code, QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void topupVoucher(int clientId, const User& user, const Voucher& voucher,
+                      QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void topupMemberVoucher(int userId, int memberDuration, const QString& voucherCode, int duration,
+                            QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void setMemberClientId(int memberId, int clientId, QObject* context = 0, const ClaimCallback& callback = ClaimCallback());
+    void resetMemberClientState(int memberId, QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void releaseMember(int memberId, int clientId, QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void resetVoucherClientState(int clientId, QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void releaseVoucher(const QString& code, int clientId, QObject* context = 0, const BoolCallback& callback = BoolCallback());
+    void stopSessions(const QHash<int, int>& memberDurations, const QHash<QString, int>& voucherDurations,
+                      const QList<int>& clientIds, const QList<int>& memberIds, const QList<Activity>& activities,
+                      QObject* context = 0, const BoolCallback& callback = BoolCallback());
+
+private:
+    QThread _thread;
+    QObject* _worker;
+};
+
+template <typename Job>
+void DatabaseExecutor::post(Job job)
+{
+    const qint64 posted = Metrics::isEnabled() ? Trace::now() : -1;
+
+    QMetaObject::invokeMethod(_worker, [job, posted]() {
+        static Metrics::Series* const wait = Metrics::summary("shiftnet_db_wait_seconds");
+        if (posted >= 0)
+            Metrics::observe(wait, Trace::now() - posted);
+        job();
+    }, Qt::QueuedConnection);
+}
+
+template <typename Job, typename Callback>
+void DatabaseExecutor::post(Job job, QObject* context, Callback callback)
+{
+    typedef decltype(job()) Result;
+    const std::function<void(const Result&)> done(callback);
+    QPointer<QObject> guard(context);
+    const qint64 posted = Metrics::isEnabled() ? Trace::now() : -1;
+
+    QMetaObject::invokeMethod(_worker, [this, job, guard, done, posted]() {
+        static Metrics::Series* const wait = Metrics::summary("shiftnet_db_wait_seconds");
+        if (posted >= 0)
+            Metrics::observe(wait, Trace::now() - posted);
+        const Result result = job();
+
+        QMetaObject::invokeMethod(this, [guard, done, result]() {
+            if (guard && done) {
+                static Metrics::Series* const callback = Metrics::summary("shiftnet_db_callback_seconds");
+                MetricsTimer timer(callback);
+                done(result);
+            }
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+}
+
+#endif // DATABASEEXECUTOR_H
@@ -0,0 +1,138 @@
+#include "durationwriter.h"
+#include "database.h"
+#include "databaseexecutor.h"
+#include "billingjournal.h"
+
+using namespace shiftnet;
+
+DurationWriter::DurationWriter(DatabaseExecutor* executor, QObject* parent)
+    : QObject(parent)
+    , _executor(executor)
+    , _journal(0)
+    , _failureCount(0)
+{
+    _timer.setInterval(60 * 1000);
+    _timer.setSingleShot(false);
+    connect(&_timer, SIGNAL(timeout()), SLOT(flush()));
+}
+
+DurationWriter::~DurationWriter()
+{
+    flush();
+}
+
+void DurationWriter::setInterval(int msec)
+{
+    _timer.setInterval(qMax(1000, msec));
+}
+
+void DurationWriter::start()
+{
+    _timer.start();
+}
+
+void DurationWriter::setMemberDuration(int memberId, int duration)
+{
+    _members.insert(memberId, duration);
+}
+
+void DurationWriter::setVoucherDuration(const QString& code, int duration)
+{
+    _vouchers.insert(code, duration);
+}
+
+void DurationWriter::discardMember(int memberId)
+{
+    _members.remove(memberId);
+}
+
+void DurationWriter::discardVoucher(const QString& code)
+{
+    _vouchers.remove(code);
+}
+
+void DurationWriter::flushMember(int memberId)
+{
+    if (!_members.contains(memberId))
+        return;
+
+    QHash<int, int> members;
+    members.insert(memberId, _members.take(memberId));
+    write(members, QHash<QString, int>());
+}
+
+void DurationWriter::flushVoucher(const QString& code)
+{
+    if (!_vouchers.contains(code))
+        return;
+
+    QHash<QString, int> vouchers;
+    vouchers.insert(code, _vouchers.take(code));
+    write(QHash<int, int>(), vouchers);
+}
+
+void DurationWriter::flush()
+{
+    // semua record jurnal sampai di sini tercakup oleh nilai yang sedang ditulis
+    const quint64 checkpoint = _journal ? _journal->lastSequence() : 0;
+    if (_journal)
+        _journal->sync();
+
+    if (_members.isEmpty() && _vouchers.isEmpty() && (!_journal || checkpoint == _journal->checkpointSequence()))
+        return;
+
+    QHash<int, int> members;
+    QHash<QString, int> vouchers;
+    members.swap(_members);
+    vouchers.swap(_vouchers);
+    write(members, vouchers, checkpoint);
+}
+
+void DurationWriter::write(const QHash<int, int>& members, const QHash<QString, int>& vouchers, quint64 checkpoint)
+{
+    const int failureCount = _failureCount;
+
+    _executor->post([members, vouchers]() -> bool {
+        if (members.isEmpty() && vouchers.isEmpty())
+            return true;
+
+        if (!Database::transaction())
+            return false;
+
+        if (!members.isEmpty() && !Database::updateMemberDurations(members)) {
+            Database::rollback();
+            return false;
+        }
+
+        if (!vouchers.isEmpty() && !Database::updateVoucherDurations(vouchers)) {
+            Database::rollback();
+            return false;
+        }
+
+        return Database::commit();
+    }, this, [this, members, vouchers, checkpoint, failureCount](bool ok) {
+        if (!ok) {
+            restore(members, vouchers);
+            return;
+        }
+
+        // tulisan lain yang gagal di antaranya belum ada di SQL, tunggu flush berikutnya
+        if (checkpoint && _journal && failureCount == _failureCount)
+            _journal->checkpoint(checkpoint);
+    });
+}
+
+void DurationWriter::restore(const QHash<int, int>& members, const QHash<QString, int>& vouchers)
+{
+    // gagal, kembalikan ke antrian kecuali sudah ada nilai yang lebih baru.
+    // Flush yang sedang berjalan tidak lagi mencakup semua record jurnal.
+    _failureCount++;
+
+    for (QHash<int, int>::const_iterator it = members.constBegin(); it != members.constEnd(); ++it)
+        if (!_members.contains(it.key()))
+            _members.insert(it.key(), it.value());
+
+    for (QHash<QString, int>::const_iterator it = vouchers.constBegin(); it != vouchers.constEnd(); ++it)
+        if (!_vouchers.contains(it.key()))
+            _vouchers.insert(it.key(), it.value());
+}
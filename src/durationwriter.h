@@ -0,0 +1,57 @@
+#ifndef DURATIONWRITER_H
+#define DURATIONWRITER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+
+namespace shiftnet {
+
+class DatabaseExecutor;
+class BillingJournal;
+
+class DurationWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DurationWriter(DatabaseExecutor* executor, QObject* parent = 0);
+    ~DurationWriter();
+
+    void setInterval(int msec);
+    inline int interval() const { return _timer.interval(); }
+
+    // flush penuh yang berhasil menjadi checkpoint jurnal
+    inline void setJournal(BillingJournal* journal) { _journal = journal; }
+
+    void setMemberDuration(int memberId, int duration);
+    void setVoucherDuration(const QString& code, int duration);
+    void discardMember(int memberId);
+    void discardVoucher(const QString& code);
+
+    void flushMember(int memberId);
+    void flushVoucher(const QString& code);
+
+    inline int pendingCount() const { return _members.size() + _vouchers.size(); }
+
+    // nilai yang gagal ditulis di tempat lain, dikembalikan ke antrian
+    void restore(const QHash<int, int>& members, const QHash<QString, int>& vouchers);
+
+public slots:
+    void start();
+    void flush();
+
+private:
+    void write(const QHash<int, int>& members, const QHash<QString, int>& vouchers, quint64 checkpoint = 0);
+
+    DatabaseExecutor* _executor;
+    BillingJournal* _journal;
+    QTimer _timer;
+    int _failureCount;
+    QHash<int, int> _members;
+    QHash<QString, int> _vouchers;
+};
+
+}
+
+#endif // DURATIONWRITER_H
@@ -0,0 +1,178 @@
+#include "frame.h"
+
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QCborValue>
+#include <QCborArray>
+#include <QVariantList>
+#include <QElapsedTimer>
+#include <QAtomicInteger>
+#include <QMutex>
+
+namespace shiftnet {
+
+class FrameData : public QSharedData
+{
+public:
+    QString type;
+    QVariant message;
+    quint64 sequence;
+    QString text;
+    QByteArray data[2];
+
+    // frame yang sama bisa di-encode dari beberapa thread I/O sekaligus
+    QMutex mutex;
+};
+
+}
+
+using namespace shiftnet;
+
+namespace {
+
+struct AtomicStats
+{
+    QAtomicInteger<quint64> count;
+    QAtomicInteger<quint64> bytes;
+    QAtomicInteger<quint64> nsecs;
+
+    void add(int size, qint64 elapsed)
+    {
+        count.fetchAndAddRelaxed(1);
+        bytes.fetchAndAddRelaxed(size);
+        nsecs.fetchAndAddRelaxed(elapsed);
+    }
+
+    Frame::Stats load() const
+    {
+        Frame::Stats stats;
+        stats.count = count.load();
+        stats.bytes = bytes.load();
+        stats.nsecs = nsecs.load();
+        return stats;
+    }
+};
+
+AtomicStats encodeStatistics[2];
+AtomicStats decodeStatistics[2];
+
+}
+
+Frame::Frame(const QString& type, const QVariant& message, quint64 sequence)
+    : d(new FrameData)
+{
+    d->type = type;
+    d->message = message;
+    d->sequence = sequence;
+}
+
+Frame::Frame(const Frame& other)
+    : d(other.d)
+{
+}
+
+Frame::~Frame()
+{
+}
+
+Frame& Frame::operator=(const Frame& other)
+{
+    d = other.d;
+    return *this;
+}
+
+QString Frame::type() const
+{
+    return d->type;
+}
+
+QVariant Frame::message() const
+{
+    return d->message;
+}
+
+quint64 Frame::sequence() const
+{
+    return d->sequence;
+}
+
+QString Frame::text() const
+{
+    QMutexLocker locker(&d->mutex);
+    if (d->text.isNull())
+        d->text = QString::fromUtf8(encode(Json));
+    return d->text;
+}
+
+QByteArray Frame::data(Format format) const
+{
+    QMutexLocker locker(&d->mutex);
+    return encode(format);
+}
+
+QByteArray Frame::encode(Format format) const
+{
+    QByteArray& encoded = d->data[format];
+    if (!encoded.isNull())
+        return encoded;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVariantList frame({ d->type, d->message });
+    if (d->sequence)
+        frame.append(d->sequence);
+
+    if (format == Cbor)
+        encoded = QCborValue::fromVariant(frame).toCbor();
+    else
+        encoded = QJsonDocument::fromVariant(frame).toJson(QJsonDocument::Compact);
+
+    encodeStatistics[format].add(encoded.size(), timer.nsecsElapsed());
+    return encoded;
+}
+
+Frame Frame::fromEncoded(const QString& type, const QByteArray& json, const QByteArray& cbor)
+{
+    Frame frame(type);
+    frame.d->data[Json] = json;
+    frame.d->data[Cbor] = cbor;
+    return frame;
+}
+
+bool Frame::decode(const QByteArray& data, Format format, QVariantList* message)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = false;
+    if (format == Cbor) {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor(data, &error);
+        if (error.error == QCborError::NoError && value.isArray()) {
+            *message = value.toArray().toVariantList();
+            ok = true;
+        }
+    }
+    else {
+        QJsonParseError error;
+        const QJsonDocument doc = QJsonDocument::fromJson(data, &error);
+        if (error.error == QJsonParseError::NoError && doc.isArray()) {
+            *message = doc.array().toVariantList();
+            ok = true;
+        }
+    }
+
+    decodeStatistics[format].add(data.size(), timer.nsecsElapsed());
+    return ok;
+}
+
+Frame::Stats Frame::encodeStats(Format format)
+{
+    return encodeStatistics[format].load();
+}
+
+Frame::Stats Frame::decodeStats(Format format)
+{
+    return decodeStatistics[format].load();
+}
@@ -0,0 +1,56 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <QSharedData>
+#include <QVariant>
+#include <QString>
+
+namespace shiftnet {
+
+class FrameData;
+
+// Pesan [type, message] yang di-encode sekali per format dan dipakai bersama
+// untuk semua penerima. Event monitor yang bisa diputar ulang dikirim sebagai
+// [type, message, sequence].
+class Frame
+{
+public:
+    enum Format {
+        Json,
+        Cbor
+    };
+
+    struct Stats {
+        quint64 count;
+        quint64 bytes;
+        quint64 nsecs;
+    };
+
+    Frame(const QString& type, const QVariant& message = QVariant(), quint64 sequence = 0);
+    Frame(const Frame& other);
+    ~Frame();
+    Frame& operator=(const Frame& other);
+
+    QString type() const;
+    QVariant message() const;
+    quint64 sequence() const;
+
+    QString text() const;
+    QByteArray data(Format format) const;
+
+    // isi sudah di-encode pemanggil untuk kedua format, message() kosong
+    static Frame fromEncoded(const QString& type, const QByteArray& json, const QByteArray& cbor);
+    static bool decode(const QByteArray& data, Format format, QVariantList* message);
+
+    static Stats encodeStats(Format format);
+    static Stats decodeStats(Format format);
+
+private:
+    QByteArray encode(Format format) const;
+
+    QExplicitlySharedDataPointer<FrameData> d;
+};
+
+}
+
+#endif // FRAME_H
@@ -0,0 +1,168 @@
+#include "ioshard.h"
+#include "outboundqueue.h"
+#include "frame.h"
+#include "metrics.h"
+
+#include <QWebSocketServer>
+#include <QWebSocket>
+#include <QTcpSocket>
+#include <QNetworkRequest>
+#include <QHostAddress>
+#include <QAtomicInteger>
+#include <QDebug>
+
+using namespace shiftnet;
+
+namespace {
+
+// id unik untuk semua shard, tidak pernah dipakai ulang
+QAtomicInteger<quint64> lastConnectionId(0);
+
+}
+
+IoShard::IoShard(int index, qint64 highWatermark, qint64 queueLimit, QObject* parent)
+    : QObject(parent)
+    , _index(index)
+    , _highWatermark(highWatermark)
+    , _queueLimit(queueLimit)
+    , _webSocketServer(new QWebSocketServer("snbs", QWebSocketServer::NonSecureMode, this))
+    , _connectionCount(0)
+{
+    connect(_webSocketServer, SIGNAL(newConnection()), SLOT(onNewConnection()));
+}
+
+void IoShard::accept(qintptr socketDescriptor)
+{
+    QMetaObject::invokeMethod(this, [this, socketDescriptor]() {
+        QTcpSocket* tcpSocket = new QTcpSocket;
+        if (!tcpSocket->setSocketDescriptor(socketDescriptor)) {
+            qWarning() << "Socket rejected:" << qPrintable(tcpSocket->errorString());
+            delete tcpSocket;
+            return;
+        }
+
+        // handshake dilakukan di thread ini, newConnection dipanggil setelah selesai
+        _webSocketServer->handleConnection(tcpSocket);
+    }, Qt::QueuedConnection);
+}
+
+void IoShard::send(quint64 connectionId, const Frame& frame, const QString& coalesceKey)
+{
+    QMetaObject::invokeMethod(this, [this, connectionId, frame, coalesceKey]() {
+        OutboundQueue* queue = _queues.value(connectionId);
+        if (queue)
+            queue->send(frame, coalesceKey);
+    }, Qt::QueuedConnection);
+}
+
+void IoShard::close(quint64 connectionId, const QString& reason)
+{
+    QMetaObject::invokeMethod(this, [this, connectionId, reason]() {
+        QWebSocket* socket = _sockets.value(connectionId);
+        if (socket)
+            socket->close(QWebSocketProtocol::CloseCodeNormal, reason);
+    }, Qt::QueuedConnection);
+}
+
+void IoShard::onNewConnection()
+{
+    while (QWebSocket* socket = _webSocketServer->nextPendingConnection()) {
+        const quint64 id = lastConnectionId.fetchAndAddRelaxed(1) + 1;
+        socket->setParent(this);
+        socket->setProperty("connection-id", id);
+        _sockets.insert(id, socket);
+        _connectionCount.ref();
+
+        OutboundQueue* queue = new OutboundQueue(socket, _highWatermark, _queueLimit);
+        _queues.insert(id, queue);
+        connect(queue, SIGNAL(backlogged()), SLOT(onQueueBacklogged()));
+        connect(queue, SIGNAL(drained()), SLOT(onQueueDrained()));
+
+        connect(socket, SIGNAL(disconnected()), SLOT(onDisconnected()));
+        connect(socket, SIGNAL(textMessageReceived(QString)), SLOT(onTextMessageReceived(QString)));
+        connect(socket, SIGNAL(binaryMessageReceived(QByteArray)), SLOT(onBinaryMessageReceived(QByteArray)));
+
+        emit connected(id, peerAddress(socket));
+    }
+}
+
+void IoShard::onDisconnected()
+{
+    QWebSocket* socket = qobject_cast<QWebSocket*>(sender());
+    const quint64 id = connectionId(socket);
+
+    // statistik antrian sudah tercatat di metrics OutboundQueue
+    _queues.remove(id);
+
+    if (_sockets.remove(id))
+        _connectionCount.deref();
+
+    socket->deleteLater();
+    emit disconnected(id);
+}
+
+void IoShard::onTextMessageReceived(const QString& message)
+{
+    QWebSocket* socket = qobject_cast<QWebSocket*>(sender());
+    socket->setProperty("received", true);
+    static Metrics::Series* const decode = Metrics::summary("shiftnet_decode_seconds", Metrics::label("format", "json"));
+    MetricsTimer timer(decode);
+
+    QVariantList data;
+    if (!Frame::decode(message.toUtf8(), Frame::Json, &data)) {
+        emit messageRejected(connectionId(socket), "Invalid json format.");
+        return;
+    }
+
+    emit messageReceived(connectionId(socket), data, Frame::Json);
+}
+
+void IoShard::onBinaryMessageReceived(const QByteArray& message)
+{
+    QWebSocket* socket = qobject_cast<QWebSocket*>(sender());
+    static Metrics::Series* const decode = Metrics::summary("shiftnet_decode_seconds", Metrics::label("format", "cbor"));
+    MetricsTimer timer(decode);
+
+    QVariantList data;
+    if (!Frame::decode(message, Frame::Cbor, &data)) {
+        emit messageRejected(connectionId(socket), "Invalid cbor format.");
+        return;
+    }
+
+    // klien yang mengirim pesan pertama dalam CBOR juga dibalas dalam CBOR
+    if (!socket->property("received").toBool()) {
+        socket->setProperty("received", true);
+        socket->setProperty("wire-format", Frame::Cbor);
+    }
+
+    emit messageReceived(connectionId(socket), data, Frame::Cbor);
+}
+
+void IoShard::onQueueBacklogged()
+{
+    OutboundQueue* queue = qobject_cast<OutboundQueue*>(sender());
+    emit backlogChanged(connectionId(queue->socket()), true);
+}
+
+void IoShard::onQueueDrained()
+{
+    OutboundQueue* queue = qobject_cast<OutboundQueue*>(sender());
+    emit backlogChanged(connectionId(queue->socket()), false);
+}
+
+QString IoShard::peerAddress(QWebSocket* socket) const
+{
+    // load generator di mesin yang sama menyamar sebagai PC lewat header handshake
+    if (!_seatAddressHeader.isEmpty() && socket->peerAddress().isLoopback()) {
+        const QHostAddress address(QString::fromLatin1(socket->request().rawHeader(_seatAddressHeader)));
+        if (!address.isNull())
+            return address.toString();
+    }
+
+    return socket->peerAddress().toString();
+}
+
+quint64 IoShard::connectionId(QObject* object) const
+{
+    return object->property("connection-id").toULongLong();
+}
@@ -0,0 +1,70 @@
+#ifndef IOSHARD_H
+#define IOSHARD_H
+
+#include <QObject>
+#include <QHash>
+#include <QAtomicInt>
+#include <QVariantList>
+#include <QByteArray>
+
+class QWebSocket;
+class QWebSocketServer;
+
+namespace shiftnet {
+
+class Frame;
+class OutboundQueue;
+
+// Sekumpulan koneksi websocket yang dilayani satu thread I/O: handshake,
+// decode pesan masuk, encode dan antrian pesan keluar. Semua state billing
+// tetap di thread utama, shard hanya meneruskan pesan lewat signal.
+class IoShard : public QObject
+{
+    Q_OBJECT
+
+public:
+    IoShard(int index, qint64 highWatermark, qint64 queueLimit, QObject* parent = 0);
+
+    inline int index() const { return _index; }
+    inline int connectionCount() const { return _connectionCount.load(); }
+
+    // hanya sebelum shard dijalankan
+    inline void setSeatAddressHeader(const QByteArray& header) { _seatAddressHeader = header; }
+
+    // boleh dipanggil dari thread mana saja
+    void accept(qintptr socketDescriptor);
+    void send(quint64 connectionId, const Frame& frame, const QString& coalesceKey);
+    void close(quint64 connectionId, const QString& reason);
+
+signals:
+    void connected(quint64 connectionId, const QString& peerAddress);
+    void disconnected(quint64 connectionId);
+    void messageReceived(quint64 connectionId, const QVariantList& message, int format);
+    void messageRejected(quint64 connectionId, const QString& reason);
+    void backlogChanged(quint64 connectionId, bool backlogged);
+
+private slots:
+    void onNewConnection();
+    void onDisconnected();
+    void onTextMessageReceived(const QString& message);
+    void onBinaryMessageReceived(const QByteArray& message);
+    void onQueueBacklogged();
+    void onQueueDrained();
+
+private:
+    QString peerAddress(QWebSocket* socket) const;
+    quint64 connectionId(QObject* object) const;
+
+    int _index;
+    qint64 _highWatermark;
+    qint64 _queueLimit;
+    QByteArray _seatAddressHeader;
+    QWebSocketServer* _webSocketServer;
+    QHash<quint64, QWebSocket*> _sockets;
+    QHash<quint64, OutboundQueue*> _queues;
+    QAtomicInt _connectionCount;
+};
+
+}
+
+#endif // IOSHARD_H
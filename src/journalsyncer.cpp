@@ -0,0 +1,104 @@
+#include "journalsyncer.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace shiftnet;
+
+JournalSyncer::JournalSyncer(QObject* parent)
+    : QThread(parent)
+    , _busy(false)
+    , _stopping(false)
+    , _failures(0)
+{
+}
+
+JournalSyncer::~JournalSyncer()
+{
+    stop();
+}
+
+void JournalSyncer::sync(uchar* address, qint64 size)
+{
+    if (size <= 0)
+        return;
+
+    QMutexLocker locker(&_mutex);
+    _ranges.append(qMakePair(address, size));
+    _condition.wakeOne();
+}
+
+void JournalSyncer::waitForIdle()
+{
+    QMutexLocker locker(&_mutex);
+    while ((!_ranges.isEmpty() || _busy) && isRunning())
+        _idle.wait(&_mutex);
+}
+
+void JournalSyncer::stop()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stopping = true;
+        _condition.wakeOne();
+    }
+
+    wait();
+}
+
+quint64 JournalSyncer::failureCount() const
+{
+    QMutexLocker locker(&_mutex);
+    return _failures;
+}
+
+void JournalSyncer::run()
+{
+#ifdef Q_OS_UNIX
+    const quintptr pageSize = quintptr(::sysconf(_SC_PAGESIZE));
+#endif
+
+    for (;;) {
+        QList<QPair<uchar*, qint64> > ranges;
+
+        {
+            QMutexLocker locker(&_mutex);
+            _busy = false;
+            _idle.wakeAll();
+
+            while (_ranges.isEmpty() && !_stopping)
+                _condition.wait(&_mutex);
+
+            // rentang yang tersisa tetap disinkronkan sebelum berhenti
+            if (_ranges.isEmpty())
+                break;
+
+            ranges.swap(_ranges);
+            _busy = true;
+        }
+
+        int failures = 0;
+        for (const QPair<uchar*, qint64>& range: ranges) {
+#ifdef Q_OS_UNIX
+            // msync butuh alamat yang rata halaman
+            const quintptr start = quintptr(range.first) & ~(pageSize - 1);
+            const quintptr end = quintptr(range.first) + quintptr(range.second);
+            if (::msync(reinterpret_cast<void*>(start), size_t(end - start), MS_SYNC) != 0)
+                failures++;
+#else
+            Q_UNUSED(range);
+#endif
+        }
+
+        if (failures) {
+            QMutexLocker locker(&_mutex);
+            if (_failures++ % 100 == 0)
+                qWarning() << "Journal cannot be synced," << _failures << "sync failures.";
+        }
+    }
+}
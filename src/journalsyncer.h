@@ -0,0 +1,44 @@
+#ifndef JOURNALSYNCER_H
+#define JOURNALSYNCER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QPair>
+
+namespace shiftnet {
+
+// msync(MS_SYNC) jurnal di thread terpisah, tick dan login tidak ikut
+// menunggu disk. Hanya rentang yang berubah sejak sync sebelumnya yang dikirim.
+class JournalSyncer : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit JournalSyncer(QObject* parent = 0);
+    ~JournalSyncer();
+
+    void sync(uchar* address, qint64 size);
+    // dipanggil sebelum mapping dilepas
+    void waitForIdle();
+    void stop();
+
+    quint64 failureCount() const;
+
+protected:
+    void run();
+
+private:
+    mutable QMutex _mutex;
+    QWaitCondition _condition;
+    QWaitCondition _idle;
+    QList<QPair<uchar*, qint64> > _ranges;
+    bool _busy;
+    bool _stopping;
+    quint64 _failures;
+};
+
+}
+
+#endif // JOURNALSYNCER_H
@@ -0,0 +1,78 @@
+#include "loginthrottle.h"
+
+#include <QDateTime>
+
+using namespace shiftnet;
+
+namespace {
+
+const int PurgeThreshold = 4096;
+
+}
+
+LoginThrottle::LoginThrottle(int limit, int window)
+    : _limit(limit)
+    , _window(window)
+    , _rejectedCount(0)
+{
+}
+
+// mengembalikan sisa waktu tunggu dalam milidetik, 0 berarti boleh dicoba
+int LoginThrottle::attempt(int clientId, const QString& username)
+{
+    if (_limit <= 0)
+        return 0;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const QString key = username.toLower();
+    const qint64 wait = qMax(waitTime(_clients, clientId, now), waitTime(_usernames, key, now));
+    if (wait > 0) {
+        _rejectedCount++;
+        return int(wait);
+    }
+
+    hit(_clients, clientId, now);
+    hit(_usernames, key, now);
+    return 0;
+}
+
+void LoginThrottle::reset(int clientId, const QString& username)
+{
+    _clients.remove(clientId);
+    _usernames.remove(username.toLower());
+}
+
+template <typename Key>
+qint64 LoginThrottle::waitTime(const QHash<Key, Bucket>& buckets, const Key& key, qint64 now) const
+{
+    typename QHash<Key, Bucket>::const_iterator it = buckets.constFind(key);
+    if (it == buckets.constEnd() || it->start + _window <= now || it->count < _limit)
+        return 0;
+
+    return it->start + _window - now;
+}
+
+template <typename Key>
+void LoginThrottle::hit(QHash<Key, Bucket>& buckets, const Key& key, qint64 now)
+{
+    if (buckets.size() >= PurgeThreshold)
+        purge(buckets, now);
+
+    Bucket& bucket = buckets[key];
+    if (bucket.count == 0 || bucket.start + _window <= now) {
+        bucket.start = now;
+        bucket.count = 0;
+    }
+    bucket.count++;
+}
+
+template <typename Key>
+void LoginThrottle::purge(QHash<Key, Bucket>& buckets, qint64 now)
+{
+    for (typename QHash<Key, Bucket>::iterator it = buckets.begin(); it != buckets.end(); ) {
+        if (it->start + _window <= now)
+            it = buckets.erase(it);
+        else
+            ++it;
+    }
+}
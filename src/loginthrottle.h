@@ -0,0 +1,46 @@
+#ifndef LOGINTHROTTLE_H
+#define LOGINTHROTTLE_H
+
+#include <QHash>
+#include <QString>
+
+namespace shiftnet {
+
+// Membatasi percobaan login per PC dan per username dalam satu jendela waktu.
+// Percobaan yang ditolak tidak sampai ke database.
+class LoginThrottle
+{
+public:
+    LoginThrottle(int limit = 5, int window = 60000);
+
+    inline void setLimit(int limit) { _limit = limit; }
+    inline void setWindow(int msec) { _window = msec; }
+
+    int attempt(int clientId, const QString& username);
+    void reset(int clientId, const QString& username);
+
+    inline quint64 rejectedCount() const { return _rejectedCount; }
+
+private:
+    struct Bucket {
+        qint64 start;
+        int count;
+    };
+
+    template <typename Key>
+    qint64 waitTime(const QHash<Key, Bucket>& buckets, const Key& key, qint64 now) const;
+    template <typename Key>
+    void hit(QHash<Key, Bucket>& buckets, const Key& key, qint64 now);
+    template <typename Key>
+    void purge(QHash<Key, Bucket>& buckets, qint64 now);
+
+    int _limit;
+    int _window;
+    QHash<int, Bucket> _clients;
+    QHash<QString, Bucket> _usernames;
+    quint64 _rejectedCount;
+};
+
+}
+
+#endif // LOGINTHROTTLE_H
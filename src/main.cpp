@@ -1,6 +1,7 @@
 #include "server.h"
 #include <iostream>
 #include <QFile>
+#include <QDateTime>
 #include <QCoreApplication>
 
 int main(int argc, char** argv)
@@ -0,0 +1,79 @@
+#include "membercache.h"
+#include "databaseexecutor.h"
+
+#include <QDateTime>
+
+using namespace shiftnet;
+
+MemberCache::MemberCache(DatabaseExecutor* executor, QObject* parent)
+    : QObject(parent)
+    , _executor(executor)
+    , _hits(0)
+    , _misses(0)
+{
+}
+
+void MemberCache::find(const QString& name, QObject* context, const Callback& callback)
+{
+    // collation username di database tidak membedakan huruf besar/kecil
+    const QString username = name.toLower();
+
+    QHash<QString, Entry>::const_iterator it = _entries.constFind(username);
+    if (it != _entries.constEnd() && it->expiration > QDateTime::currentMSecsSinceEpoch()) {
+        _hits++;
+        callback(it->record);
+        return;
+    }
+
+    QHash<QString, QList<PendingCallback> >::iterator pending = _pending.find(username);
+    if (pending != _pending.end()) {
+        _hits++;
+        pending->append(PendingCallback(context, callback));
+        return;
+    }
+
+    _misses++;
+    _pending.insert(username, QList<PendingCallback>() << PendingCallback(context, callback));
+
+    _executor->findMember(name, this, [this, username](const QSqlRecord& record) {
+        // invalidate() selama query berjalan berarti hasil ini mungkin sudah basi
+        if (!_stale.remove(username))
+            insert(username, record);
+
+        const QList<PendingCallback> callbacks = _pending.take(username);
+        for (const PendingCallback& pendingCallback: callbacks)
+            if (pendingCallback.first)
+                pendingCallback.second(record);
+    });
+}
+
+void MemberCache::invalidate(const QString& name)
+{
+    const QString username = name.toLower();
+    _entries.remove(username);
+
+    if (_pending.contains(username))
+        _stale.insert(username);
+}
+
+void MemberCache::insert(const QString& username, const QSqlRecord& record)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (_entries.size() >= Capacity) {
+        for (QHash<QString, Entry>::iterator it = _entries.begin(); it != _entries.end(); ) {
+            if (it->expiration <= now)
+                it = _entries.erase(it);
+            else
+                ++it;
+        }
+
+        if (_entries.size() >= Capacity)
+            _entries.clear();
+    }
+
+    Entry entry;
+    entry.record = record;
+    entry.expiration = now + (record.isEmpty() ? UnknownMemberTtl : MemberTtl);
+    _entries.insert(username, entry);
+}
@@ -0,0 +1,63 @@
+#ifndef MEMBERCACHE_H
+#define MEMBERCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QPair>
+#include <QPointer>
+#include <QSqlRecord>
+
+#include <functional>
+
+namespace shiftnet {
+
+class DatabaseExecutor;
+
+// Hasil findMember disimpan sebentar, termasuk username yang tidak ditemukan,
+// supaya percobaan login berulang tidak selalu menjadi query. Pencarian yang
+// sama selagi query berjalan ikut menunggu hasil query tersebut.
+class MemberCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(const QSqlRecord&)> Callback;
+
+    enum {
+        Capacity = 2000,
+        MemberTtl = 30000,
+        UnknownMemberTtl = 10000
+    };
+
+    explicit MemberCache(DatabaseExecutor* executor, QObject* parent = 0);
+
+    void find(const QString& username, QObject* context, const Callback& callback);
+    void invalidate(const QString& username);
+
+    inline int count() const { return _entries.size(); }
+    inline quint64 hits() const { return _hits; }
+    inline quint64 misses() const { return _misses; }
+
+private:
+    struct Entry {
+        QSqlRecord record;
+        qint64 expiration;
+    };
+
+    typedef QPair<QPointer<QObject>, Callback> PendingCallback;
+
+    void insert(const QString& username, const QSqlRecord& record);
+
+    DatabaseExecutor* _executor;
+    QHash<QString, Entry> _entries;
+    QHash<QString, QList<PendingCallback> > _pending;
+    QSet<QString> _stale;
+    quint64 _hits;
+    quint64 _misses;
+};
+
+}
+
+#endif // MEMBERCACHE_H
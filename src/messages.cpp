@@ -0,0 +1,146 @@
+#include "messages.h"
+
+#include <QVariant>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QHash>
+
+using namespace shiftnet;
+
+namespace {
+
+struct MessageEntry
+{
+    const char* name;
+    Message::Type type;
+};
+
+const MessageEntry clientMessages[] = {
+    { "init",              Message::ClientInit },
+    { "guest-login",       Message::GuestLogin },
+    { "member-login",      Message::MemberLogin },
+    { "session-stop",      Message::SessionStop },
+    { "user-topup",        Message::UserTopup },
+    { "maintenance-start", Message::MaintenanceStart },
+    { "maintenance-stop",  Message::MaintenanceStop },
+};
+
+const MessageEntry monitorMessages[] = {
+    { "init",             Message::MonitorInit },
+    { "stop-sessions",    Message::StopSessions },
+    { "shutdown-clients", Message::ShutdownClients },
+    { "restart-clients",  Message::RestartClients },
+    { "reload-clients",   Message::ReloadClients },
+    { "trace-start",      Message::TraceStart },
+    { "trace-stop",       Message::TraceStop },
+    { "trace-dump",       Message::TraceDump },
+};
+
+template <int N>
+QHash<QString, Message::Type> createIndex(const MessageEntry (&entries)[N])
+{
+    QHash<QString, Message::Type> index;
+    index.reserve(N);
+    for (const MessageEntry& entry: entries)
+        index.insert(QString::fromLatin1(entry.name), entry.type);
+    return index;
+}
+
+// null dianggap string kosong, tipe lain ditolak
+bool readString(const QVariant& value, QString* string)
+{
+    if (value.isNull()) {
+        string->clear();
+        return true;
+    }
+
+    if (value.userType() != QMetaType::QString)
+        return false;
+
+    *string = value.toString();
+    return true;
+}
+
+bool readStrings(const QVariant& payload, int count, QString* strings[])
+{
+    if (payload.userType() != QMetaType::QVariantList)
+        return false;
+
+    const QVariantList values = payload.toList();
+    if (values.size() != count)
+        return false;
+
+    for (int i = 0; i < count; i++)
+        if (!readString(values.at(i), strings[i]))
+            return false;
+
+    return true;
+}
+
+}
+
+Message::Type Message::clientMessageType(const QString& type)
+{
+    static const QHash<QString, Type> index = createIndex(clientMessages);
+    return index.value(type, Unknown);
+}
+
+Message::Type Message::monitorMessageType(const QString& type)
+{
+    static const QHash<QString, Type> index = createIndex(monitorMessages);
+    return index.value(type, Unknown);
+}
+
+bool ClientInitMessage::decode(const QVariant& payload)
+{
+    return readString(payload, &state);
+}
+
+bool GuestLoginMessage::decode(const QVariant& payload)
+{
+    QString* strings[] = { &username, &voucherCode };
+    return readStrings(payload, 2, strings);
+}
+
+bool MemberLoginMessage::decode(const QVariant& payload)
+{
+    QString* strings[] = { &username, &password, &voucherCode };
+    return readStrings(payload, 3, strings);
+}
+
+bool UserTopupMessage::decode(const QVariant& payload)
+{
+    return readString(payload, &voucherCode);
+}
+
+bool MonitorInitMessage::decode(const QVariant& payload)
+{
+    // monitor lama tidak mengirim opsi apa pun
+    const QVariantMap options = payload.userType() == QMetaType::QVariantMap ? payload.toMap() : QVariantMap();
+    clientsSync = options.value("clientsSync").toBool();
+    aggregateStops = options.value("aggregateStops").toBool();
+    sequenced = options.contains("resumeFrom") || options.contains("stream");
+    resumeFrom = options.value("resumeFrom").toULongLong();
+    stream = options.value("stream").toULongLong();
+    return true;
+}
+
+bool ClientIdsMessage::decode(const QVariant& payload)
+{
+    if (payload.userType() != QMetaType::QVariantList)
+        return false;
+
+    const QVariantList values = payload.toList();
+    ids.clear();
+    ids.reserve(values.size());
+
+    for (const QVariant& value: values) {
+        bool ok = false;
+        const int id = value.toInt(&ok);
+        if (!ok)
+            return false;
+        ids.append(id);
+    }
+
+    return true;
+}
@@ -0,0 +1,100 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <QString>
+#include <QList>
+
+class QVariant;
+
+namespace shiftnet {
+
+// Daftar tipe pesan dari client dan client-monitor beserta payload-nya.
+// Payload di-decode dan divalidasi sebelum diteruskan ke handler.
+class Message
+{
+public:
+    enum Type {
+        Unknown,
+
+        // client
+        ClientInit,
+        GuestLogin,
+        MemberLogin,
+        SessionStop,
+        UserTopup,
+        MaintenanceStart,
+        MaintenanceStop,
+
+        // client-monitor
+        MonitorInit,
+        StopSessions,
+        ShutdownClients,
+        RestartClients,
+        ReloadClients,
+        TraceStart,
+        TraceStop,
+        TraceDump
+    };
+
+    static Type clientMessageType(const QString& type);
+    static Type monitorMessageType(const QString& type);
+
+private:
+    Message();
+};
+
+struct ClientInitMessage
+{
+    QString state;
+
+    bool decode(const QVariant& payload);
+};
+
+struct GuestLoginMessage
+{
+    QString username;
+    QString voucherCode;
+
+    bool decode(const QVariant& payload);
+};
+
+struct MemberLoginMessage
+{
+    QString username;
+    QString password;
+    QString voucherCode;
+
+    bool decode(const QVariant& payload);
+};
+
+struct UserTopupMessage
+{
+    QString voucherCode;
+
+    bool decode(const QVariant& payload);
+};
+
+struct MonitorInitMessage
+{
+    bool clientsSync;
+    // clients-session-stop satu event untuk semua PC, bukan client-session-stop per PC
+    bool aggregateStops;
+    // monitor yang mengirim resumeFrom/stream menerima event bernomor urut [type, message, sequence]
+    bool sequenced;
+    // 0 berarti minta snapshot lengkap
+    quint64 resumeFrom;
+    quint64 stream;
+
+    bool decode(const QVariant& payload);
+};
+
+struct ClientIdsMessage
+{
+    QList<int> ids;
+
+    bool decode(const QVariant& payload);
+};
+
+}
+
+#endif // MESSAGES_H
@@ -0,0 +1,263 @@
+#include "metrics.h"
+
+#include <QHash>
+#include <QMap>
+#include <QReadWriteLock>
+#include <QAtomicInteger>
+#include <QtAlgorithms>
+
+using namespace shiftnet;
+
+QAtomicInt Metrics::_enabled(0);
+
+namespace {
+
+enum Type {
+    Counter,
+    Gauge,
+    Summary
+};
+
+// 16 bucket per kelipatan dua, p50/p99 (batas atas bucket) paling banyak ~6% terlalu besar
+enum {
+    SubBucketBits = 4,
+    SubBucketCount = 1 << SubBucketBits,
+    BucketCount = 64 * SubBucketCount
+};
+
+int bucketIndex(quint64 value)
+{
+    if (value < SubBucketCount)
+        return int(value);
+
+    const int msb = 63 - qCountLeadingZeroBits(value);
+    const int sub = int(value >> (msb - SubBucketBits)) & (SubBucketCount - 1);
+    return msb * SubBucketCount + sub;
+}
+
+quint64 bucketUpperBound(int index)
+{
+    const int msb = index / SubBucketCount;
+    const int sub = index % SubBucketCount;
+    if (msb < SubBucketBits)
+        return quint64(index);
+
+    return (quint64(SubBucketCount + sub + 1) << (msb - SubBucketBits)) - 1;
+}
+
+}
+
+struct Metrics::Series
+{
+    inline Series(const char* name, const QString& labels)
+        : name(name), labels(labels), value(0), count(0), sum(0), max(0), buckets(0) {}
+    inline ~Series() { delete[] buckets; }
+
+    const char* name;
+    QString labels;
+
+    QAtomicInteger<qint64> value;
+    QAtomicInteger<quint64> count;
+    QAtomicInteger<quint64> sum;
+    QAtomicInteger<quint64> max;
+    QAtomicInteger<quint32>* buckets;
+
+    quint64 quantile(double q) const
+    {
+        quint64 total = 0;
+        quint32 counts[BucketCount];
+        for (int i = 0; i < BucketCount; i++)
+            total += counts[i] = buckets[i].load();
+
+        if (total == 0)
+            return 0;
+
+        const quint64 rank = qMax<quint64>(1, quint64(q * total + 0.5));
+        quint64 seen = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank)
+                return qMin(bucketUpperBound(i), max.load());
+        }
+
+        return max.load();
+    }
+};
+
+namespace {
+
+struct Family
+{
+    Type type;
+    QMap<QString, Metrics::Series*> series;
+};
+
+QReadWriteLock lock;
+QMap<QByteArray, Family> families;
+
+Metrics::Series* series(const char* name, const QString& labels, Type type)
+{
+    {
+        QReadLocker locker(&lock);
+        QMap<QByteArray, Family>::const_iterator family = families.constFind(QByteArray::fromRawData(name, qstrlen(name)));
+        if (family != families.constEnd()) {
+            Metrics::Series* s = family->series.value(labels);
+            if (s)
+                return s;
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    Family& family = families[QByteArray(name)];
+    if (family.series.isEmpty())
+        family.type = type;
+
+    Metrics::Series*& s = family.series[labels];
+    if (!s) {
+        s = new Metrics::Series(name, labels);
+        if (type == Summary)
+            s->buckets = new QAtomicInteger<quint32>[BucketCount];
+    }
+    return s;
+}
+
+QByteArray seconds(quint64 nsecs)
+{
+    return QByteArray::number(nsecs / 1e9, 'f', 9);
+}
+
+void appendSample(QByteArray& out, const QByteArray& name, const char* suffix, const QString& labels,
+                  const QByteArray& value, const char* extraLabel = 0)
+{
+    out += name;
+    out += suffix;
+    if (!labels.isEmpty() || extraLabel) {
+        out += '{';
+        out += labels.toUtf8();
+        if (extraLabel) {
+            if (!labels.isEmpty())
+                out += ',';
+            out += extraLabel;
+        }
+        out += '}';
+    }
+    out += ' ';
+    out += value;
+    out += '\n';
+}
+
+}
+
+void Metrics::setEnabled(bool enabled)
+{
+    _enabled.store(enabled ? 1 : 0);
+}
+
+Metrics::Series* Metrics::counter(const char* name, const QString& labels)
+{
+    return series(name, labels, Counter);
+}
+
+Metrics::Series* Metrics::gauge(const char* name, const QString& labels)
+{
+    return series(name, labels, Gauge);
+}
+
+Metrics::Series* Metrics::summary(const char* name, const QString& labels)
+{
+    return series(name, labels, Summary);
+}
+
+void Metrics::increment(Series* series, qint64 value)
+{
+    if (series && isEnabled())
+        series->value.fetchAndAddRelaxed(value);
+}
+
+void Metrics::add(Series* series, qint64 delta)
+{
+    if (series && isEnabled())
+        series->value.fetchAndAddRelaxed(delta);
+}
+
+void Metrics::set(Series* series, qint64 value)
+{
+    if (series && isEnabled())
+        series->value.store(value);
+}
+
+void Metrics::observe(Series* s, qint64 nsecs)
+{
+    if (!s || !isEnabled() || !s->buckets)
+        return;
+
+    const quint64 value = quint64(qMax(Q_INT64_C(0), nsecs));
+    s->count.fetchAndAddRelaxed(1);
+    s->sum.fetchAndAddRelaxed(value);
+    s->buckets[bucketIndex(value)].fetchAndAddRelaxed(1);
+
+    quint64 max = s->max.load();
+    while (value > max && !s->max.testAndSetRelaxed(max, value))
+        max = s->max.load();
+}
+
+void Metrics::increment(const char* name, const QString& labels, qint64 value)
+{
+    if (isEnabled())
+        increment(counter(name, labels), value);
+}
+
+void Metrics::set(const char* name, const QString& labels, qint64 value)
+{
+    if (isEnabled())
+        set(gauge(name, labels), value);
+}
+
+const char* Metrics::name(const Series* series)
+{
+    return series->name;
+}
+
+QString Metrics::labels(const Series* series)
+{
+    return series->labels;
+}
+
+QString Metrics::label(const char* key, const QString& value)
+{
+    QString escaped = value;
+    escaped.replace('\\', "\\\\").replace('"', "\\\"").replace('\n', "\\n");
+    return QString("%1=\"%2\"").arg(QLatin1String(key), escaped);
+}
+
+QByteArray Metrics::render()
+{
+    static const char* typeNames[] = { "counter", "gauge", "summary" };
+
+    QByteArray out;
+    QByteArray maxima;
+    QReadLocker locker(&lock);
+
+    for (QMap<QByteArray, Family>::const_iterator family = families.constBegin(); family != families.constEnd(); ++family) {
+        out += "# TYPE " + family.key() + ' ' + typeNames[family->type] + '\n';
+        if (family->type == Summary)
+            maxima += "# TYPE " + family.key() + "_max gauge\n";
+
+        for (QMap<QString, Series*>::const_iterator it = family->series.constBegin(); it != family->series.constEnd(); ++it) {
+            const Metrics::Series* s = it.value();
+            if (family->type == Summary) {
+                appendSample(out, family.key(), "", it.key(), seconds(s->quantile(0.5)), "quantile=\"0.5\"");
+                appendSample(out, family.key(), "", it.key(), seconds(s->quantile(0.99)), "quantile=\"0.99\"");
+                appendSample(out, family.key(), "_sum", it.key(), seconds(s->sum.load()));
+                appendSample(out, family.key(), "_count", it.key(), QByteArray::number(s->count.load()));
+                appendSample(maxima, family.key(), "_max", it.key(), seconds(s->max.load()));
+            }
+            else {
+                appendSample(out, family.key(), "", it.key(), QByteArray::number(s->value.load()));
+            }
+        }
+    }
+
+    // maksimum ditulis sebagai gauge terpisah supaya blok summary tetap valid
+    return out + maxima;
+}
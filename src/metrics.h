@@ -0,0 +1,87 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+
+#include "trace.h"
+
+namespace shiftnet {
+
+// Counter, gauge dan summary bergaya Prometheus. Summary menyimpan histogram
+// log-linear (16 bucket per kelipatan dua, galat p50/p99 di bawah 7%) untuk
+// p50/p99 dan nilai maksimum.
+// Pemanggil di jalur panas menyimpan pointer Series sekali (biasanya static
+// lokal), pencatatan selanjutnya hanya operasi atomic tanpa lock. Lock hanya
+// dipakai saat series dicari/dibuat lewat nama dan saat endpoint membaca semua
+// series. Selama metrics tidak aktif (Metrics/port=0) tidak ada yang dicatat.
+class Metrics
+{
+public:
+    struct Series;
+
+    static void setEnabled(bool enabled);
+    static inline bool isEnabled() { return _enabled.load(); }
+
+    static Series* counter(const char* name, const QString& labels = QString());
+    static Series* gauge(const char* name, const QString& labels = QString());
+    static Series* summary(const char* name, const QString& labels = QString());
+
+    // series boleh 0, tidak ada yang dicatat
+    static void increment(Series* series, qint64 value = 1);
+    static void add(Series* series, qint64 delta);
+    static void set(Series* series, qint64 value);
+    static void observe(Series* series, qint64 nsecs);
+
+    // untuk kejadian jarang, series dicari lewat nama di setiap panggilan
+    static void increment(const char* name, const QString& labels = QString(), qint64 value = 1);
+    static void set(const char* name, const QString& labels, qint64 value);
+
+    static const char* name(const Series* series);
+    static QString labels(const Series* series);
+
+    static QString label(const char* key, const QString& value);
+    static QByteArray render();
+
+private:
+    Metrics();
+
+    static QAtomicInt _enabled;
+};
+
+// Mencatat lama sebuah scope ke summary saat keluar dari scope, sekaligus
+// sebagai span jika tracing aktif. Series boleh 0.
+class MetricsTimer
+{
+public:
+    inline explicit MetricsTimer(Metrics::Series* series)
+        : _series(series), _start(series && Trace::isEnabled() ? Trace::now() : -1)
+    {
+        if (_series && (_start >= 0 || Metrics::isEnabled()))
+            _timer.start();
+        else
+            _series = 0;
+    }
+
+    inline ~MetricsTimer()
+    {
+        if (!_series)
+            return;
+
+        const qint64 elapsed = _timer.nsecsElapsed();
+        Metrics::observe(_series, elapsed);
+        if (_start >= 0)
+            Trace::record(Metrics::name(_series), Metrics::labels(_series), _start, elapsed);
+    }
+
+private:
+    Metrics::Series* _series;
+    qint64 _start;
+    QElapsedTimer _timer;
+};
+
+}
+
+#endif // METRICS_H
@@ -0,0 +1,83 @@
+#include "metricsserver.h"
+#include "metrics.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QDebug>
+
+using namespace shiftnet;
+
+namespace {
+
+const int MaxRequestSize = 8192;
+
+void respond(QTcpSocket* socket, const QByteArray& status, const QByteArray& contentType, const QByteArray& body)
+{
+    socket->write("HTTP/1.1 " + status + "\r\n"
+                  "Content-Type: " + contentType + "\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n\r\n");
+    socket->write(body);
+    socket->disconnectFromHost();
+}
+
+}
+
+MetricsServer::MetricsServer(QObject* parent)
+    : QThread(parent)
+    , _port(0)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    stop();
+}
+
+void MetricsServer::listen(const QHostAddress& address, quint16 port)
+{
+    _address = address;
+    _port = port;
+    start();
+}
+
+void MetricsServer::stop()
+{
+    quit();
+    wait();
+}
+
+void MetricsServer::run()
+{
+    QTcpServer server;
+    if (!server.listen(_address, _port)) {
+        qWarning() << "Metrics server failed:" << qPrintable(server.errorString());
+        return;
+    }
+
+    connect(&server, &QTcpServer::newConnection, [&server]() {
+        while (QTcpSocket* socket = server.nextPendingConnection()) {
+            connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            connect(socket, &QTcpSocket::readyRead, socket, [socket]() {
+                if (!socket->canReadLine()) {
+                    if (socket->bytesAvailable() > MaxRequestSize)
+                        socket->abort();
+                    return;
+                }
+
+                // cukup baris pertama, header lain tidak dipakai
+                const QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+                socket->readAll();
+
+                if (request.size() < 2 || request.at(0) != "GET")
+                    respond(socket, "405 Method Not Allowed", "text/plain", "");
+                else if (request.at(1) != "/metrics")
+                    respond(socket, "404 Not Found", "text/plain", "");
+                else
+                    respond(socket, "200 OK", "text/plain; version=0.0.4", Metrics::render());
+            });
+        }
+    });
+
+    exec();
+}
@@ -0,0 +1,32 @@
+#ifndef METRICSSERVER_H
+#define METRICSSERVER_H
+
+#include <QThread>
+#include <QHostAddress>
+
+namespace shiftnet {
+
+// Endpoint HTTP /metrics di thread sendiri, hanya membaca Metrics sehingga
+// tidak pernah menunggu event loop utama.
+class MetricsServer : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsServer(QObject* parent = 0);
+    ~MetricsServer();
+
+    void listen(const QHostAddress& address, quint16 port);
+    void stop();
+
+protected:
+    void run();
+
+private:
+    QHostAddress _address;
+    quint16 _port;
+};
+
+}
+
+#endif // METRICSSERVER_H
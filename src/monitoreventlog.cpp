@@ -0,0 +1,41 @@
+#include "monitoreventlog.h"
+
+#include <QDateTime>
+
+using namespace shiftnet;
+
+MonitorEventLog::MonitorEventLog(int capacity)
+    : _capacity(qMax(1, capacity))
+    , _stream(quint64(QDateTime::currentMSecsSinceEpoch()))
+    , _lastSequence(0)
+{
+}
+
+void MonitorEventLog::setCapacity(int capacity)
+{
+    _capacity = qMax(1, capacity);
+    trim();
+}
+
+Frame MonitorEventLog::append(const QString& type, const QVariant& message)
+{
+    const Frame frame(type, message, ++_lastSequence);
+    _frames.append(frame);
+    trim();
+    return frame;
+}
+
+bool MonitorEventLog::since(quint64 sequence, QList<Frame>* frames) const
+{
+    if (sequence > _lastSequence || sequence + 1 < firstSequence())
+        return false;
+
+    *frames = _frames.mid(int(sequence + 1 - firstSequence()));
+    return true;
+}
+
+void MonitorEventLog::trim()
+{
+    while (_frames.size() > _capacity)
+        _frames.removeFirst();
+}
@@ -0,0 +1,41 @@
+#ifndef MONITOREVENTLOG_H
+#define MONITOREVENTLOG_H
+
+#include <QList>
+
+#include "frame.h"
+
+namespace shiftnet {
+
+// Event untuk client-monitor diberi nomor urut dan beberapa yang terakhir
+// disimpan, monitor yang tersambung ulang cukup menerima event yang
+// terlewat. Stream berganti setiap server dijalankan ulang.
+class MonitorEventLog
+{
+public:
+    explicit MonitorEventLog(int capacity = 4096);
+
+    void setCapacity(int capacity);
+    inline int capacity() const { return _capacity; }
+
+    inline quint64 stream() const { return _stream; }
+    inline quint64 lastSequence() const { return _lastSequence; }
+    inline quint64 firstSequence() const { return _lastSequence - _frames.size() + 1; }
+
+    Frame append(const QString& type, const QVariant& message);
+
+    // false jika sebagian event sesudah sequence sudah terbuang
+    bool since(quint64 sequence, QList<Frame>* frames) const;
+
+private:
+    void trim();
+
+    int _capacity;
+    quint64 _stream;
+    quint64 _lastSequence;
+    QList<Frame> _frames;
+};
+
+}
+
+#endif // MONITOREVENTLOG_H
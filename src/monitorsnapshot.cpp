@@ -0,0 +1,144 @@
+#include "monitorsnapshot.h"
+#include "client.h"
+#include "monitoreventlog.h"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QCborValue>
+
+using namespace shiftnet;
+
+namespace {
+
+// header CBOR untuk array/map yang isinya disambung sendiri
+void appendCborHeader(QByteArray* data, quint8 majorType, quint64 length)
+{
+    const char major = char(majorType << 5);
+    if (length < 24) {
+        data->append(char(major | char(length)));
+        return;
+    }
+
+    int bytes = 8;
+    char info = 27;
+    if (length <= 0xff) {
+        bytes = 1;
+        info = 24;
+    }
+    else if (length <= 0xffff) {
+        bytes = 2;
+        info = 25;
+    }
+    else if (length <= 0xffffffffu) {
+        bytes = 4;
+        info = 26;
+    }
+
+    data->append(char(major | info));
+    for (int i = bytes - 1; i >= 0; i--)
+        data->append(char((length >> (i * 8)) & 0xff));
+}
+
+void appendCborNumber(QByteArray* data, const char* key, quint64 value)
+{
+    data->append(QCborValue(QString::fromLatin1(key)).toCbor());
+    data->append(QCborValue(qint64(value)).toCbor());
+}
+
+}
+
+MonitorSnapshot::MonitorSnapshot()
+    : _company(encode(QVariantMap()))
+    , _version(1)
+    , _frameVersion(0)
+    , _frameSequence(0)
+    , _buildCount(0)
+    , _encodeCount(0)
+    , _frame("init")
+{
+}
+
+void MonitorSnapshot::setCompany(const QVariant& name, const QVariant& address)
+{
+    _company = encode(QVariantMap({
+        { "name", name },
+        { "address", address },
+    }));
+    _version++;
+}
+
+void MonitorSnapshot::update(Client* client)
+{
+    // toMap baru dipanggil saat frame dibutuhkan, tick tiap menit cukup menandai
+    _clients.insert(client->id(), client);
+    _dirty.insert(client);
+    _version++;
+}
+
+void MonitorSnapshot::remove(Client* client)
+{
+    if (_clients.value(client->id()) != client)
+        return;
+
+    _clients.remove(client->id());
+    _entries.remove(client->id());
+    _dirty.remove(client);
+    _version++;
+}
+
+Frame MonitorSnapshot::frame(const MonitorEventLog& events)
+{
+    if (_frameVersion == _version && _frameSequence == events.lastSequence())
+        return _frame;
+
+    for (Client* client: _dirty) {
+        _entries.insert(client->id(), encode(client->toMap()));
+        _encodeCount++;
+    }
+    _dirty.clear();
+
+    // ["init", {company, clients, version, stream, sequence}], isi PC cukup disalin
+    QByteArray json("[\"init\",{\"company\":");
+    json += _company.json;
+    json += ",\"clients\":[";
+
+    QByteArray cbor;
+    appendCborHeader(&cbor, 4, 2);
+    cbor += QCborValue(QStringLiteral("init")).toCbor();
+    appendCborHeader(&cbor, 5, 5);
+    cbor += QCborValue(QStringLiteral("company")).toCbor();
+    cbor += _company.cbor;
+    cbor += QCborValue(QStringLiteral("clients")).toCbor();
+    appendCborHeader(&cbor, 4, quint64(_entries.size()));
+
+    bool first = true;
+    for (const Fragment& entry: _entries) {
+        if (!first)
+            json += ',';
+        first = false;
+        json += entry.json;
+        cbor += entry.cbor;
+    }
+
+    json += "],\"version\":" + QByteArray::number(_version)
+            + ",\"stream\":" + QByteArray::number(events.stream())
+            + ",\"sequence\":" + QByteArray::number(events.lastSequence()) + "}]";
+    appendCborNumber(&cbor, "version", _version);
+    appendCborNumber(&cbor, "stream", events.stream());
+    appendCborNumber(&cbor, "sequence", events.lastSequence());
+
+    _frame = Frame::fromEncoded("init", json, cbor);
+    _frameVersion = _version;
+    _frameSequence = events.lastSequence();
+    _buildCount++;
+
+    return _frame;
+}
+
+MonitorSnapshot::Fragment MonitorSnapshot::encode(const QVariant& value)
+{
+    Fragment fragment;
+    fragment.json = QJsonDocument(QJsonObject::fromVariantMap(value.toMap())).toJson(QJsonDocument::Compact);
+    fragment.cbor = QCborValue::fromVariant(value).toCbor();
+    return fragment;
+}
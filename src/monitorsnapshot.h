@@ -0,0 +1,58 @@
+#ifndef MONITORSNAPSHOT_H
+#define MONITORSNAPSHOT_H
+
+#include <QVariantMap>
+#include <QByteArray>
+#include <QMap>
+#include <QSet>
+
+#include "frame.h"
+
+namespace shiftnet {
+
+class Client;
+class MonitorEventLog;
+
+// Isi pesan init untuk client-monitor: data perusahaan dan semua PC.
+// Setiap PC menyimpan hasil encode JSON dan CBOR-nya sendiri, perubahan
+// hanya menandai PC tersebut. Frame init disusun dari potongan yang sudah
+// di-encode, jadi tick tiap menit hanya meng-encode ulang PC yang berubah.
+class MonitorSnapshot
+{
+public:
+    MonitorSnapshot();
+
+    void setCompany(const QVariant& name, const QVariant& address);
+    void update(Client* client);
+    void remove(Client* client);
+
+    inline quint64 version() const { return _version; }
+    inline quint64 buildCount() const { return _buildCount; }
+    inline quint64 encodeCount() const { return _encodeCount; }
+
+    // sequence event terakhir ikut dikirim supaya monitor bisa melanjutkan dari situ
+    Frame frame(const MonitorEventLog& events);
+
+private:
+    struct Fragment {
+        QByteArray json;
+        QByteArray cbor;
+    };
+
+    static Fragment encode(const QVariant& value);
+
+    Fragment _company;
+    QMap<int, Client*> _clients;
+    QMap<int, Fragment> _entries;
+    QSet<Client*> _dirty;
+    quint64 _version;
+    quint64 _frameVersion;
+    quint64 _frameSequence;
+    quint64 _buildCount;
+    quint64 _encodeCount;
+    Frame _frame;
+};
+
+}
+
+#endif // MONITORSNAPSHOT_H
@@ -0,0 +1,144 @@
+#include "outboundqueue.h"
+
+#include "metrics.h"
+
+#include <QWebSocket>
+#include <QDebug>
+
+using namespace shiftnet;
+
+QAtomicInteger<quint64> OutboundQueue::_totalSentBytes(0);
+
+OutboundQueue::OutboundQueue(QWebSocket* socket, qint64 highWatermark, qint64 limit)
+    : QObject(socket)
+    , _socket(socket)
+    , _highWatermark(highWatermark)
+    , _limit(limit)
+    , _queuedBytes(0)
+    , _maxDepth(0)
+    , _sentBytes(0)
+    , _coalescedCount(0)
+    , _droppedCount(0)
+    , _overflowed(false)
+{
+    connect(socket, SIGNAL(bytesWritten(qint64)), SLOT(drain()));
+}
+
+OutboundQueue::~OutboundQueue()
+{
+    account(-_frames.size(), -_queuedBytes);
+}
+
+void OutboundQueue::send(const Frame& frame, const QString& coalesceKey)
+{
+    if (_overflowed)
+        return;
+
+    if (_frames.isEmpty() && canWrite()) {
+        write(frame);
+        return;
+    }
+
+    // ukuran dihitung dari encoding yang akan dipakai, hasil encode di-cache oleh Frame
+    const bool binary = _socket->property("wire-format").toInt() == Frame::Cbor;
+    const qint64 size = binary ? frame.data(Frame::Cbor).size() : frame.data(Frame::Json).size();
+
+    if (!coalesceKey.isEmpty()) {
+        for (int i = 0; i < _frames.size(); i++) {
+            if (_frames.at(i).key != coalesceKey)
+                continue;
+
+            // frame sync lama sudah tidak berlaku. Yang baru ditaruh di belakang
+            // supaya tidak mendahului frame yang diantrikan setelah frame lama.
+            account(-1, -_frames.at(i).size);
+            _frames.removeAt(i);
+            _coalescedCount++;
+            Metrics::increment("shiftnet_outbound_coalesced_total");
+            break;
+        }
+    }
+
+    Pending pending = { frame, coalesceKey, size };
+    _frames.append(pending);
+    if (_frames.size() == 1)
+        emit backlogged();
+    account(1, size);
+    _maxDepth = qMax(_maxDepth, _frames.size());
+
+    if (_queuedBytes > _limit) {
+        qWarning() << "Slow consumer disconnected:" << qPrintable(_socket->peerAddress().toString())
+                   << _frames.size() << "frames," << _queuedBytes << "bytes queued";
+
+        _droppedCount += _frames.size();
+        Metrics::increment("shiftnet_outbound_dropped_total", QString(), _frames.size());
+        Metrics::increment("shiftnet_slow_consumers_total");
+        account(-_frames.size(), -_queuedBytes);
+        _frames.clear();
+        _overflowed = true;
+
+        // abort() langsung memancarkan disconnected, ditunda supaya pemanggil
+        // yang sedang mengirim ke banyak koneksi selesai lebih dulu
+        QWebSocket* socket = _socket;
+        QMetaObject::invokeMethod(socket, [socket]() { socket->abort(); }, Qt::QueuedConnection);
+        emit overflowed();
+    }
+}
+
+quint64 OutboundQueue::totalSentBytes()
+{
+    return _totalSentBytes.load();
+}
+
+void OutboundQueue::drain()
+{
+    if (_frames.isEmpty())
+        return;
+
+    while (!_frames.isEmpty() && canWrite()) {
+        const Pending pending = _frames.takeFirst();
+        account(-1, -pending.size);
+        write(pending.frame);
+    }
+
+    if (_frames.isEmpty())
+        emit drained();
+}
+
+bool OutboundQueue::canWrite() const
+{
+    return _socket->bytesToWrite() < _highWatermark;
+}
+
+qint64 OutboundQueue::write(const Frame& frame)
+{
+    static Metrics::Series* const writeTime = Metrics::summary("shiftnet_write_seconds");
+    static Metrics::Series* const sentBytes = Metrics::counter("shiftnet_outbound_bytes_total");
+    MetricsTimer timer(writeTime);
+    qint64 size;
+    if (_socket->property("wire-format").toInt() == Frame::Cbor) {
+        const QByteArray data = frame.data(Frame::Cbor);
+        _socket->sendBinaryMessage(data);
+        size = data.size();
+    }
+    else {
+        _socket->sendTextMessage(frame.text());
+        size = frame.data(Frame::Json).size();
+    }
+
+    _sentBytes += size;
+    _totalSentBytes.fetchAndAddRelaxed(size);
+    Metrics::increment(sentBytes, size);
+    return size;
+}
+
+void OutboundQueue::account(int frames, qint64 bytes)
+{
+    static Metrics::Series* const queuedFrames = Metrics::gauge("shiftnet_outbound_queued_frames");
+    static Metrics::Series* const queuedBytes = Metrics::gauge("shiftnet_outbound_queued_bytes");
+
+    _queuedBytes += bytes;
+    if (frames)
+        Metrics::add(queuedFrames, frames);
+    if (bytes)
+        Metrics::add(queuedBytes, bytes);
+}
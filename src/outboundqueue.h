@@ -0,0 +1,74 @@
+#ifndef OUTBOUNDQUEUE_H
+#define OUTBOUNDQUEUE_H
+
+#include <QObject>
+#include <QList>
+#include <QAtomicInteger>
+
+#include "frame.h"
+
+class QWebSocket;
+
+namespace shiftnet {
+
+// Antrian kirim per koneksi. Frame langsung ditulis selama buffer socket di
+// bawah high-watermark, selebihnya ditahan di sini. Frame sync yang tertahan
+// dibuang saat frame sync berikutnya dengan key yang sama masuk di akhir
+// antrian, dan koneksi yang antriannya melewati batas diputus.
+class OutboundQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    OutboundQueue(QWebSocket* socket, qint64 highWatermark, qint64 limit);
+    ~OutboundQueue();
+
+    void send(const Frame& frame, const QString& coalesceKey = QString());
+
+    inline QWebSocket* socket() const { return _socket; }
+    inline bool isBacklogged() const { return !_frames.isEmpty(); }
+    inline int depth() const { return _frames.size(); }
+    inline int maxDepth() const { return _maxDepth; }
+    inline qint64 queuedBytes() const { return _queuedBytes; }
+    inline quint64 sentBytes() const { return _sentBytes; }
+    inline quint64 coalescedCount() const { return _coalescedCount; }
+    inline quint64 droppedCount() const { return _droppedCount; }
+
+    static quint64 totalSentBytes();
+
+signals:
+    void backlogged();
+    void drained();
+    void overflowed();
+
+private slots:
+    void drain();
+
+private:
+    struct Pending {
+        Frame frame;
+        QString key;
+        qint64 size;
+    };
+
+    bool canWrite() const;
+    qint64 write(const Frame& frame);
+    void account(int frames, qint64 bytes);
+
+    QWebSocket* _socket;
+    qint64 _highWatermark;
+    qint64 _limit;
+    QList<Pending> _frames;
+    qint64 _queuedBytes;
+    int _maxDepth;
+    quint64 _sentBytes;
+    quint64 _coalescedCount;
+    quint64 _droppedCount;
+    bool _overflowed;
+
+    static QAtomicInteger<quint64> _totalSentBytes;
+};
+
+}
+
+#endif // OUTBOUNDQUEUE_H
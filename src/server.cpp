@@ -2,8 +2,14 @@
 #include "client.h"
 #include "database.h"
 #include "vouchervalidator.h"
-
-#include <QWebSocket>
+#include "frame.h"
+#include "messages.h"
+#include "sessionsnapshot.h"
+#include "connection.h"
+#include "ioshard.h"
+#include "metrics.h"
+
+#include <QPointer>
 #include <QJsonDocument>
 #include <QJsonParseError>
 #include <QJsonObject>
@@ -13,8 +19,32 @@
 #include <QVariant>
 #include <QCryptographicHash>
 #include <QSqlRecord>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QDateTime>
 #include <QDebug>
 
+#ifdef Q_OS_UNIX
+#include <QSocketNotifier>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+// SIGUSR1 hanya menulis satu byte, trace disimpan dari event loop utama
+int traceSignalFds[2];
+
+void handleTraceSignal(int)
+{
+    char c = 1;
+    ssize_t written = ::write(traceSignalFds[0], &c, sizeof(c));
+    Q_UNUSED(written);
+}
+
+}
+#endif
+
 #define ACTIVITY_USER_TOPUP "topup"
 #define ACTIVITY_USER_SESSION_START "session-start"
 #define ACTIVITY_USER_SESSION_STOP  "session-stop"
@@ -26,11 +56,40 @@ using namespace shiftnet;
 Server::Server(QObject *parent)
     : QObject(parent)
     , settings("shiftnet-billing-server.ini", QSettings::IniFormat)
-    , webSocketServer("snbs", QWebSocketServer::NonSecureMode)
+    , timingWheel(1000)
+    , durationWriter(&databaseExecutor)
+    , clientRegistry(&timingWheel)
+    , voucherIndex(&databaseExecutor)
+    , memberCache(&databaseExecutor)
+    , traceDumping(false)
 {
     Database::setup(settings);
 
-    connect(&webSocketServer, SIGNAL(newConnection()), SLOT(onWebSocketConnected()));
+    connect(&timingWheel, SIGNAL(ticked(int,qint64)), SLOT(onTimingWheelTicked(int,qint64)));
+
+    // semua perubahan dalam satu putaran event loop dikirim dalam satu frame clients-sync
+    clientsSyncTimer.setInterval(0);
+    clientsSyncTimer.setSingleShot(true);
+    connect(&clientsSyncTimer, SIGNAL(timeout()), SLOT(flushClientsSync()));
+
+    connect(&clientRegistry, SIGNAL(clientAdded(Client*)), SLOT(onClientAdded(Client*)));
+    connect(&clientRegistry, SIGNAL(clientRetired(Client*)), SLOT(onClientRetired(Client*)));
+    connect(&clientRegistry, SIGNAL(loaded(int,int,int,qint64)), SLOT(onClientRegistryLoaded(int,int,int,qint64)));
+    connect(&clientsReloadTimer, SIGNAL(timeout()), SLOT(reloadClients()));
+    connect(&sessionSnapshotTimer, SIGNAL(timeout()), SLOT(saveSessionSnapshot()));
+    connect(&metricsTimer, SIGNAL(timeout()), SLOT(updateMetrics()));
+
+    durationWriter.setInterval(settings.value("Server/durationFlushInterval", 60).toInt() * 1000);
+    activityLog.setCapacity(settings.value("Server/activityQueueCapacity", 10000).toInt());
+    sessionSnapshotFile = settings.value("Server/sessionSnapshotFile", "shiftnet-sessions.dat").toString();
+    traceFile = settings.value("Server/traceFile", "shiftnet-trace.json").toString();
+    monitorSnapshot.setCompany(settings.value("Company/name"), settings.value("Company/address"));
+    monitorEvents.setCapacity(settings.value("Server/monitorReplayCapacity", 4096).toInt());
+    monitorReplayLimit = settings.value("Server/outboundQueueLimit", 1024 * 1024).toLongLong() / 2;
+    Trace::setCapacity(settings.value("Server/traceCapacity", 100000).toInt());
+    Trace::setEnabled(settings.value("Server/tracing", false).toBool());
+    loginThrottle.setLimit(settings.value("Server/loginAttemptLimit", 5).toInt());
+    loginThrottle.setWindow(settings.value("Server/loginAttemptWindow", 60).toInt() * 1000);
 }
 
 bool Server::start()
@@ -40,125 +99,508 @@ bool Server::start()
         return false;
     }
 
-    for (const QSqlRecord& record : Database::clients()) {
-        Client* client = new Client(this);
-        client->setId(record.value("id").toInt());
-        client->setHostAddress(record.value("ipAddress").toString());
-        client->setMacAddress(record.value("macAddress").toString());
+    activityLog.start();
+    databaseExecutor.start();
 
-        clients.append(client);
-        clientsByIds.insert(client->id(), client);
+    QHash<int, int> journalMembers;
+    QHash<QString, int> journalVouchers;
+    if (!recoverJournal(&journalMembers, &journalVouchers)) {
+        qCritical() << "Journal recovery failed!";
+        return false;
+    }
 
-        connect(client, SIGNAL(sessionTimeout(User)), SLOT(onClientSessionTimeout(User)));
-        connect(client, SIGNAL(voucherSessionTimeout(QString)), SLOT(onVoucherSessionTimeout(QString)));
-        connect(client, SIGNAL(sessionUpdated()), SLOT(onClientSessionUpdated()));
+    clientRegistry.load(Database::clients());
+    restoreSessions(journalMembers, journalVouchers);
+
+    QList<QSqlRecord> vouchers;
+    do {
+        vouchers = Database::activeVouchers(voucherIndex.lastVoucherId(), VoucherIndex::PageSize);
+        voucherIndex.load(vouchers);
+    } while (vouchers.size() == VoucherIndex::PageSize);
+    qWarning() << "Voucher index:" << voucherIndex.count() << "active vouchers loaded";
+
+    // selanjutnya semua query berjalan di databaseExecutor
+    Database::closeConnection();
+
+    // alamat PC dari header handshake hanya untuk build load test, server lalu hanya mendengar di loopback
+    QByteArray seatAddressHeader;
+    QHostAddress listenAddress(QHostAddress::Any);
+#ifdef SHIFTNET_SEAT_ADDRESS_HEADER
+    seatAddressHeader = settings.value("Server/seatAddressHeader").toByteArray();
+    if (!seatAddressHeader.isEmpty()) {
+        listenAddress = QHostAddress::LocalHost;
+        qWarning() << "Seat address header" << seatAddressHeader << "enabled, listening on localhost only";
+    }
+#else
+    if (!settings.value("Server/seatAddressHeader").toByteArray().isEmpty())
+        qWarning() << "Server/seatAddressHeader ignored, build with SHIFTNET_SEAT_ADDRESS_HEADER for load tests";
+#endif
+
+    socketServer.start(settings.value("Server/ioThreads", qMax(1, QThread::idealThreadCount() - 1)).toInt(),
+                       settings.value("Server/outboundHighWatermark", 64 * 1024).toLongLong(),
+                       settings.value("Server/outboundQueueLimit", 1024 * 1024).toLongLong(),
+                       seatAddressHeader);
+
+    for (IoShard* shard: socketServer.shards()) {
+        connect(shard, SIGNAL(connected(quint64,QString)), SLOT(onWebSocketConnected(quint64,QString)));
+        connect(shard, SIGNAL(disconnected(quint64)), SLOT(onWebSocketDisconnected(quint64)));
+        connect(shard, SIGNAL(messageReceived(quint64,QVariantList,int)), SLOT(onWebSocketMessageReceived(quint64,QVariantList,int)));
+        connect(shard, SIGNAL(messageRejected(quint64,QString)), SLOT(onWebSocketMessageRejected(quint64,QString)));
+        connect(shard, SIGNAL(backlogChanged(quint64,bool)), SLOT(onWebSocketBacklogChanged(quint64,bool)));
     }
 
-    if (!webSocketServer.listen(QHostAddress::Any, settings.value("Server/port").toInt())) {
+    if (!socketServer.listen(listenAddress, settings.value("Server/port").toInt())) {
         qCritical() << "Websocket server failed!";
         return false;
     }
 
+    durationWriter.start();
+    voucherIndex.setRefreshInterval(settings.value("Server/voucherRefreshInterval", 60).toInt() * 1000);
+    voucherIndex.setSweepInterval(settings.value("Server/voucherSweepInterval", 60).toInt() * 1000);
+
+#ifdef Q_OS_UNIX
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, traceSignalFds) == 0) {
+        QSocketNotifier* notifier = new QSocketNotifier(traceSignalFds[1], QSocketNotifier::Read, this);
+        connect(notifier, SIGNAL(activated(int)), SLOT(onTraceSignal()));
+        ::signal(SIGUSR1, handleTraceSignal);
+    }
+#endif
+
+    // tanpa endpoint tidak ada yang dicatat, jalur billing cukup mengecek satu flag
+    const int metricsPort = settings.value("Metrics/port", 0).toInt();
+    Metrics::setEnabled(metricsPort > 0);
+    if (metricsPort > 0) {
+        const QString address = settings.value("Metrics/address").toString();
+        metricsServer.listen(address.isEmpty() ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(address), metricsPort);
+        metricsTimer.setInterval(1000);
+        metricsTimer.start();
+    }
+
+    const int snapshotInterval = settings.value("Server/sessionSnapshotInterval", 30).toInt();
+    if (snapshotInterval > 0) {
+        sessionSnapshotTimer.setInterval(snapshotInterval * 1000);
+        sessionSnapshotTimer.start();
+    }
+
+    const int reloadInterval = settings.value("Server/clientsReloadInterval", 300).toInt();
+    if (reloadInterval > 0) {
+        clientsReloadTimer.setInterval(reloadInterval * 1000);
+        clientsReloadTimer.start();
+    }
+
     return true;
 }
 
+void Server::reloadClients()
+{
+    databaseExecutor.post([]() { return Database::clients(); }, this, [this](const QList<QSqlRecord>& records) {
+        // hasil kosong berarti query gagal, jangan hapus semua PC
+        if (!records.isEmpty())
+            clientRegistry.load(records);
+    });
+}
+
+bool Server::recoverJournal(QHash<int, int>* members, QHash<QString, int>* vouchers)
+{
+    const QString fileName = settings.value("Server/journalFile", "shiftnet-journal.dat").toString();
+    if (fileName.isEmpty())
+        return true;
+
+    const int capacity = settings.value("Server/journalCapacity", 65536).toInt();
+    if (!journal.open(fileName, capacity)) {
+        qWarning() << "Billing journal disabled";
+        return true;
+    }
+
+    // sisa waktu di jurnal lebih baru dari SQL, tulis dulu sebelum voucher dan sesi dimuat
+    QHash<QString, BillingJournal::PendingTopup> topups;
+    journal.recover(members, vouchers, &topups);
+
+    // hasil topup tidak sempat dicatat, voucher yang sudah terhapus berarti topup sudah masuk SQL.
+    // Tanpa record sisa waktu sesudah checkpoint, nilai di SQL sudah benar.
+    for (QHash<QString, BillingJournal::PendingTopup>::const_iterator it = topups.constBegin(); it != topups.constEnd(); ++it) {
+        if (members->contains(it->memberId) && Database::findVoucher(it.key()).isEmpty())
+            (*members)[it->memberId] += it->duration;
+    }
+
+    if (!members->isEmpty() || !vouchers->isEmpty()) {
+        if (!Database::transaction())
+            return false;
+
+        if ((!members->isEmpty() && !Database::updateMemberDurations(*members))
+                || (!vouchers->isEmpty() && !Database::updateVoucherDurations(*vouchers))
+                || !Database::commit()) {
+            Database::rollback();
+            return false;
+        }
+
+        qWarning() << "Journal recovered:" << members->size() << "members," << vouchers->size() << "vouchers";
+    }
+
+    if (!journal.reset(capacity)) {
+        journal.close();
+        qWarning() << "Billing journal disabled";
+        return true;
+    }
+
+    durationWriter.setJournal(&journal);
+    return true;
+}
+
+void Server::restoreSessions(const QHash<int, int>& journalMembers, const QHash<QString, int>& journalVouchers)
+{
+    QList<SessionSnapshot::Session> sessions;
+    QDateTime dateTime;
+    if (!SessionSnapshot::load(sessionSnapshotFile, &sessions, &dateTime))
+        return;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // snapshot yang terlalu lama tidak lagi mencerminkan pemakaian sebenarnya
+    const int maxAge = settings.value("Server/sessionSnapshotMaxAge", 900).toInt();
+    if (dateTime.secsTo(QDateTime::currentDateTimeUtc()) > maxAge) {
+        qWarning() << "Session snapshot from" << dateTime.toLocalTime().toString() << "is too old, sessions not restored";
+        return;
+    }
+
+    // Database::init sudah melepas semua PC, klaim ulang sesi yang masih tercatat
+    int restored = 0;
+    for (const SessionSnapshot::Session& session: sessions) {
+        User user = session.user;
+        Voucher activeVoucher = session.activeVoucher;
+
+        // jurnal ditulis setiap tick, lebih baru dari snapshot
+        if (user.isMember() && journalMembers.contains(user.id())) {
+            user.addDuration(journalMembers.value(user.id()) - user.duration());
+        }
+        else if (user.isGuest() && journalVouchers.contains(activeVoucher.code())) {
+            const int duration = journalVouchers.value(activeVoucher.code());
+            user.addDuration(duration - activeVoucher.duration());
+            activeVoucher = Voucher(activeVoucher.code(), duration, activeVoucher.id());
+        }
+
+        Client* client = clientRegistry.findById(session.clientId);
+        if (!client || user.duration() <= 0 || (user.isGuest() && activeVoucher.duration() <= 0))
+            continue;
+
+        QList<Voucher> vouchers;
+        if (user.isGuest())
+            vouchers << activeVoucher << session.vouchers;
+
+        if (!Database::restoreClientState(client->id(), user, vouchers))
+            continue;
+
+        client->restoreSession(user, activeVoucher, session.vouchers);
+        monitorSnapshot.update(client);
+        if (user.isMember())
+            durationWriter.setMemberDuration(user.id(), user.duration());
+        else
+            durationWriter.setVoucherDuration(activeVoucher.code(), activeVoucher.duration());
+        restored++;
+    }
+
+    qWarning() << "Sessions restored:" << restored << "of" << sessions.size() << "in" << timer.elapsed() << "ms";
+
+    if (restored > 0)
+        timingWheel.schedule(settings.value("Server/sessionRestoreGrace", 300).toInt() * 1000,
+                             [this]() { expireSuspendedSessions(); });
+}
+
+void Server::updateMetrics()
+{
+    // state di thread utama disalin ke gauge, endpoint cukup membaca atomic
+    int activeSessions = 0;
+    for (Client* client: clientRegistry.clients())
+        if (client->state() == Client::Used)
+            activeSessions++;
+
+    Metrics::set("shiftnet_connections", QString(), socketServer.connectionCount());
+    Metrics::set("shiftnet_clients_connected", QString(), clientSockets.size());
+    Metrics::set("shiftnet_monitors_connected", QString(), clientMonitorSockets.size());
+    Metrics::set("shiftnet_sessions_active", QString(), activeSessions);
+    Metrics::set("shiftnet_timer_entries", QString(), timingWheel.count());
+    Metrics::set("shiftnet_duration_writer_pending", QString(), durationWriter.pendingCount());
+    Metrics::set("shiftnet_journal_pending", QString(), journal.pendingCount());
+    Metrics::set("shiftnet_monitor_snapshot_version", QString(), monitorSnapshot.version());
+    Metrics::set("shiftnet_monitor_snapshot_builds", QString(), monitorSnapshot.buildCount());
+    Metrics::set("shiftnet_monitor_snapshot_encodes", QString(), monitorSnapshot.encodeCount());
+    Metrics::set("shiftnet_monitor_event_sequence", QString(), monitorEvents.lastSequence());
+    Metrics::set("shiftnet_journal_dropped", QString(), journal.droppedCount());
+    Metrics::set("shiftnet_activity_queue_pending", QString(), activityLog.pendingCount());
+    Metrics::set("shiftnet_activity_dropped", QString(), activityLog.droppedCount());
+    Metrics::set("shiftnet_voucher_index_size", QString(), voucherIndex.count());
+    Metrics::set("shiftnet_voucher_index_hits", QString(), voucherIndex.hits());
+    Metrics::set("shiftnet_voucher_index_misses", QString(), voucherIndex.misses());
+    Metrics::set("shiftnet_voucher_index_expired", QString(), voucherIndex.expiredCount());
+    Metrics::set("shiftnet_member_cache_size", QString(), memberCache.count());
+    Metrics::set("shiftnet_statement_cache_hits", QString(), Database::statementCacheHits());
+    Metrics::set("shiftnet_statement_cache_misses", QString(), Database::statementCacheMisses());
+}
+
+void Server::onTraceSignal()
+{
+#ifdef Q_OS_UNIX
+    char c;
+    ssize_t count = ::read(traceSignalFds[1], &c, sizeof(c));
+    Q_UNUSED(count);
+#endif
+
+    dumpTrace();
+}
+
+void Server::dumpTrace(Connection* connection)
+{
+    if (traceDumping) {
+        sendTo(connection, "trace-dump-failed", traceFile);
+        return;
+    }
+
+    // ratusan ribu span diubah ke JSON di thread sendiri, event loop billing tidak ikut menunggu
+    traceDumping = true;
+    const QPointer<Connection> monitor = connection;
+    const QString fileName = traceFile;
+
+    QThread* thread = QThread::create([this, monitor, fileName]() {
+        int count = 0;
+        const bool ok = Trace::dump(fileName, &count);
+
+        QMetaObject::invokeMethod(this, [this, monitor, fileName, ok, count]() {
+            traceDumping = false;
+            if (ok)
+                qWarning() << "Trace dumped:" << count << "spans to" << qPrintable(fileName);
+
+            if (!monitor)
+                return;
+
+            if (!ok) {
+                sendTo(monitor, "trace-dump-failed", fileName);
+                return;
+            }
+
+            sendTo(monitor, "trace-dumped", QVariantMap({
+                { "file", fileName },
+                { "spans", count },
+            }));
+        }, Qt::QueuedConnection);
+    });
+
+    thread->setObjectName("trace-dump");
+    connect(thread, SIGNAL(finished()), thread, SLOT(deleteLater()));
+    thread->start(QThread::LowPriority);
+}
+
+void Server::saveSessionSnapshot()
+{
+    SessionSnapshot::save(sessionSnapshotFile, clientRegistry.clients());
+}
+
+void Server::expireSuspendedSessions()
+{
+    for (Client* client: clientRegistry.clients())
+        if (client->hasSuspendedSession())
+            endSuspendedSession(client, "PC tidak tersambung kembali setelah server dijalankan ulang.");
+}
+
+void Server::resumeSession(Client* client)
+{
+    client->resumeSession();
+
+    const User user = client->user();
+    activityLog.log(client->id(), user, ACTIVITY_USER_SESSION_START,
+                    "Pemakaian dilanjutkan setelah server dijalankan ulang.", client->activeVoucher().id());
+
+    sendTo(client->connection(), "session-start", QVariantMap({
+        { "username", user.username() },
+        { "duration", user.duration() },
+    }));
+    notifyClientChanged("client-session-start", client);
+}
+
+void Server::endSuspendedSession(Client* client, const QString& reason)
+{
+    const User user = client->user();
+    const Voucher voucher = client->activeVoucher();
+
+    flushClientDuration(client);
+    if (user.isMember())
+        releaseMember(user);
+    else
+        releaseClientVouchers(client->id());
+
+    activityLog.log(client->id(), user, ACTIVITY_USER_SESSION_STOP, "Sesi pemakaian dihentikan. " + reason, voucher.id());
+
+    client->resetSession();
+    notifyClientChanged("client-session-stop", client);
+    clientRegistry.retireIfOffline(client);
+}
+
 // WebSocket Callbacks
-void Server::onWebSocketConnected()
+void Server::onWebSocketConnected(quint64 connectionId, const QString& peerAddress)
 {
-    QWebSocket* socket = webSocketServer.nextPendingConnection();
-    connect(socket, SIGNAL(disconnected()), SLOT(onWebSocketDisconnected()));
-    connect(socket, SIGNAL(textMessageReceived(QString)), SLOT(onWebSocketTextMessageReceived(QString)));
+    IoShard* shard = qobject_cast<IoShard*>(sender());
+    connections.insert(connectionId, new Connection(shard, connectionId, QHostAddress(peerAddress), this));
 }
 
-void Server::onWebSocketDisconnected()
+void Server::onWebSocketDisconnected(quint64 connectionId)
 {
-    QWebSocket* socket = qobject_cast<QWebSocket*>(sender());
+    Connection* socket = connections.take(connectionId);
+    if (!socket)
+        return;
+
+    socket->deleteLater();
+    staleClientsSyncSockets.remove(socket);
+
     if (socket->property("client-type").toString() == "client") {
-        Client* client = clientsByIds.value(socket->property("client-id").toInt());
+        Client* client = clientRegistry.findById(socket->property("client-id").toInt());
         const User user = client->user();
 
         if (user.isMember() || user.isGuest()) {
-            Database::transaction();
+            flushClientDuration(client);
+
             Voucher voucher = client->activeVoucher();
             if (user.isMember())
-                Database::resetMemberClientState(user.id());
+                releaseMember(user);
             else
-                Database::resetVoucherClientState(client->id());
+                releaseClientVouchers(client->id());
 
-            Database::logUserActivity(client->id(), user, ACTIVITY_USER_SESSION_STOP,
-                                      QString("Koneksi terputus, sesi telah dihentikan."),
-                                      voucher.id());
-            Database::commit();
+            activityLog.log(client->id(), user, ACTIVITY_USER_SESSION_STOP,
+                            QString("Koneksi terputus, sesi telah dihentikan."),
+                            voucher.id());
         }
 
         client->resetConnection();
-        sendToClientMonitors("client-disconnected", client->toMap());
+        notifyClientChanged("client-disconnected", client);
         clientSockets.removeOne(socket);
+        clientRegistry.retireIfOffline(client);
     }
     else if (socket->property("client-type").toString() == "client-monitor") {
         clientMonitorSockets.removeOne(socket);
+        clientsSyncMonitorSockets.removeOne(socket);
+        aggregateStopMonitorSockets.removeOne(socket);
+        sequencedMonitorSockets.removeOne(socket);
     }
 }
 
-void Server::onWebSocketTextMessageReceived(const QString& jsonString)
+void Server::onWebSocketMessageReceived(quint64 connectionId, const QVariantList& message, int format)
 {
-    QString closeReason;
-    QJsonParseError jsonParseError;
-    QWebSocket* socket = qobject_cast<QWebSocket*>(sender());
-    const QJsonDocument doc = QJsonDocument::fromJson(jsonString.toUtf8(), &jsonParseError);
+    Connection* socket = connections.value(connectionId);
+    if (!socket)
+        return;
 
-    for (;;) {
-        if (!(jsonParseError.error == QJsonParseError::NoError && doc.isArray())) {
-            closeReason = "Invalid json format.";
-            break;
-        }
+    socket->setReceived(Frame::Format(format));
+    processMessage(socket, message);
+}
 
-        QVariantList data = doc.array().toVariantList();
-        if (data.size() != 3) {
-            closeReason = "Invalid json format.";
-            break;
-        }
+void Server::onWebSocketMessageRejected(quint64 connectionId, const QString& reason)
+{
+    Connection* socket = connections.value(connectionId);
+    if (socket)
+        closeConnection(socket, reason);
+}
 
-        const QString clientType = data.at(0).toString();
+void Server::onWebSocketBacklogChanged(quint64 connectionId, bool backlogged)
+{
+    Connection* socket = connections.value(connectionId);
+    if (!socket)
+        return;
 
-        if (socket->property("client-type").toString() == "") {
-            if (clientType == "client-monitor") {
-                clientMonitorSockets.append(socket);
-            }
-            else if (clientType == "client") {
-                Client* client = findClient(socket->peerAddress());
-                if (!client) {
-                    closeReason = "Client not registered";
-                    break;
-                }
-                client->setConnection(socket);
-                socket->setProperty("client-id", client->id());
-                clientSockets.append(socket);
-            }
-            else {
-                closeReason = "Unknown client type";
-                break;
-            }
+    socket->setBacklogged(backlogged);
 
-            socket->setProperty("client-type", clientType);
-        }
+    // perubahan tidak bisa digabung, monitor yang tertinggal dikirimi semua client setelah antriannya kosong
+    if (backlogged || !staleClientsSyncSockets.remove(socket))
+        return;
 
-        if (clientType == "client") {
-            processClientMessage(socket, data.at(1).toString(), data.at(2));
-            return;
+    QList<int> clientIds;
+    for (Client* client: clientRegistry.clients())
+        clientIds << client->id();
+
+    // nomor urut terakhir, event yang terlewat sudah tercakup dan resume berikutnya mulai dari sini
+    const quint64 sequence = isSequenced(socket) ? monitorEvents.lastSequence() : 0;
+    sendFrame(socket, Frame("clients-sync", clientsSyncChanges(clientIds), sequence));
+}
+
+void Server::processMessage(Connection* socket, const QVariantList& data)
+{
+    if (data.size() != 3) {
+        closeConnection(socket, "Invalid message format.");
+        return;
+    }
+
+    const QString clientType = data.at(0).toString();
+
+    if (socket->property("client-type").toString() == "") {
+        if (clientType == "client-monitor") {
+            clientMonitorSockets.append(socket);
+        }
+        else if (clientType == "client") {
+            Client* client = clientRegistry.findByAddress(socket->peerAddress());
+            if (!client) {
+                closeConnection(socket, "Client not registered");
+                return;
+            }
+            client->setConnection(socket);
+            socket->setProperty("client-id", client->id());
+            clientSockets.append(socket);
         }
-        else if (clientType == "client-monitor") {
-            processClientMonitorMessage(socket, data.at(1).toString(), data.at(2));
+        else {
+            closeConnection(socket, "Unknown client type");
             return;
         }
 
-        closeReason = "Unknown client type. " + jsonString;
-        break;
+        socket->setProperty("client-type", clientType);
+    }
+
+    // tipe client tidak boleh berubah setelah pesan pertama
+    if (socket->property("client-type").toString() != clientType) {
+        closeConnection(socket, "Unknown client type. " + clientType);
+        return;
+    }
+
+    if (data.at(1).userType() != QMetaType::QString) {
+        closeConnection(socket, "Invalid message format.");
+        return;
     }
 
-    qWarning() << "Connection refused:" << qPrintable(closeReason);
+    const QString type = data.at(1).toString();
+    const Message::Type messageType = clientType == "client" ? Message::clientMessageType(type)
+                                                             : Message::monitorMessageType(type);
+    const bool measured = Metrics::isEnabled() || Trace::isEnabled();
+    const MessageMetrics metrics = measured ? messageMetrics(clientType, messageType, type) : MessageMetrics();
+    Metrics::increment(metrics.count);
+    MetricsTimer timer(metrics.handler);
 
-    socket->close(QWebSocketProtocol::CloseCodeNormal, closeReason);
+    if (clientType == "client") {
+        processClientMessage(socket, data.at(1).toString(), data.at(2));
+    }
+    else {
+        processClientMonitorMessage(socket, data.at(1).toString(), data.at(2));
+    }
+}
+
+Server::MessageMetrics Server::messageMetrics(const QString& clientType, Message::Type messageType, const QString& type)
+{
+    // label hanya dibuat sekali per tipe pesan, tipe yang tidak dikenal digabung
+    const int key = (clientType == "client" ? 0 : 1000) + messageType;
+    QHash<int, MessageMetrics>::const_iterator it = messageSeries.constFind(key);
+    if (it != messageSeries.constEnd())
+        return it.value();
+
+    const QString labels = Metrics::label("source", clientType) + ","
+            + Metrics::label("type", messageType == Message::Unknown ? QString("unknown") : type);
+    const MessageMetrics metrics = {
+        Metrics::counter("shiftnet_messages_total", labels),
+        Metrics::summary("shiftnet_handler_seconds", labels),
+    };
+    messageSeries.insert(key, metrics);
+    return metrics;
+}
+
+void Server::closeConnection(Connection* socket, const QString& reason)
+{
+    qWarning() << "Connection refused:" << qPrintable(reason);
+
+    socket->close(reason);
 }
 
 // Client Callbacks
@@ -168,58 +610,155 @@ void Server::onClientSessionTimeout(const User& user)
     Client* client = qobject_cast<Client*>(sender());
 
     if (user.isMember() || user.isGuest()) {
-        Database::transaction();
-        Voucher voucher = client->activeVoucher();
         if (user.isMember()) {
-            Database::resetMemberClientState(user.id());
-            Database::updateMemberDuration(user.id(), 0);
+            journal.append(BillingJournal::SessionStop, client->id(), User::createMember(user.id(), user.username(), 0), Voucher());
+            durationWriter.setMemberDuration(user.id(), 0);
+            durationWriter.flushMember(user.id());
         }
-        else {
-            Database::resetVoucherClientState(client->id());
-        }
-        Database::logUserActivity(client->id(), user, ACTIVITY_USER_SESSION_STOP,
-                                  QString("Pemakaian dihentikan karena sisa waktu telah habis."),
-                                  voucher.id());
-        Database::commit();
+
+        Voucher voucher = client->activeVoucher();
+        if (user.isMember())
+            releaseMember(user);
+        else
+            releaseClientVouchers(client->id());
+
+        activityLog.log(client->id(), user, ACTIVITY_USER_SESSION_STOP,
+                        QString("Pemakaian dihentikan karena sisa waktu telah habis."),
+                        voucher.id());
     }
 
     sendTo(client->connection(), "session-timeout", QVariant());
-    sendToClientMonitors("client-session-timeout", client->toMap());
+    notifyClientChanged("client-session-timeout", client);
 }
 
 void Server::onVoucherSessionTimeout(const QString& voucherCode)
 {
     Client* client = qobject_cast<Client*>(sender());
-    Database::logUserActivity(client->id(), client->user(),
-                              ACTIVITY_USER_SESSION_STOP, QString("Pemakaian dihentikan. Durasi voucher %1 telah habis.").arg(voucherCode),
-                              client->activeVoucher().id());
-    Database::deleteVoucher(voucherCode);
+    activityLog.log(client->id(), client->user(),
+                    ACTIVITY_USER_SESSION_STOP, QString("Pemakaian dihentikan. Durasi voucher %1 telah habis.").arg(voucherCode),
+                    client->activeVoucher().id());
+    durationWriter.discardVoucher(voucherCode);
+    voucherIndex.remove(voucherCode);
+    databaseExecutor.deleteVoucher(voucherCode);
 }
 
 void Server::onClientSessionUpdated()
 {
     Client* client = qobject_cast<Client*>(sender());
     User user = client->user();
-    if (user.isMember())
-        Database::updateMemberDuration(user.id(), user.duration());
+    if (user.isMember()) {
+        journal.append(BillingJournal::Tick, client->id(), user, Voucher());
+        durationWriter.setMemberDuration(user.id(), user.duration());
+    }
     else {
+        // voucher yang habis sudah dihapus di onVoucherSessionTimeout
         Voucher activeVoucher = client->activeVoucher();
-        Database::updateVoucherDuration(activeVoucher.code(), activeVoucher.duration());
+        if (activeVoucher.duration() > 0) {
+            journal.append(BillingJournal::Tick, client->id(), user, activeVoucher);
+            durationWriter.setVoucherDuration(activeVoucher.code(), activeVoucher.duration());
+            voucherIndex.setDuration(activeVoucher.code(), activeVoucher.duration());
+        }
+    }
+
+    sendFrame(client->connection(), Frame("session-sync", user.duration()), "session-sync");
+    monitorSnapshot.update(client);
+
+    // monitor lama tetap menerima client-session-sync per client
+    if (clientMonitorSockets.size() > clientsSyncMonitorSockets.size()) {
+        const Frame frame("client-session-sync", client->toMap());
+        const QString coalesceKey = "client-session-sync:" + QString::number(client->id());
+
+        for (Connection* socket: clientMonitorSockets)
+            if (!clientsSyncMonitorSockets.contains(socket))
+                sendFrame(socket, frame, coalesceKey);
+    }
+
+    // tetap dicatat tanpa monitor supaya monitor yang tersambung ulang bisa mengejar
+    pendingClientsSyncIds.insert(client->id());
+    if (!clientsSyncTimer.isActive())
+        clientsSyncTimer.start();
+}
+
+void Server::flushClientsSync()
+{
+    if (pendingClientsSyncIds.isEmpty())
+        return;
+
+    const QVariantList changes = clientsSyncChanges(pendingClientsSyncIds.values());
+    pendingClientsSyncIds.clear();
+
+    if (changes.isEmpty())
+        return;
+
+    const Frame frame = monitorEvents.append("clients-sync", changes);
+    const Frame plainFrame("clients-sync", changes);
+
+    // salinan, daftar bisa berubah jika ada koneksi yang terputus selama pengiriman
+    const QList<Connection*> sockets = clientsSyncMonitorSockets;
+    for (Connection* socket: sockets) {
+        if (socket->isBacklogged())
+            staleClientsSyncSockets.insert(socket);
+        else
+            sendFrame(socket, isSequenced(socket) ? frame : plainFrame);
     }
+}
+
+QVariantList Server::clientsSyncChanges(const QList<int>& clientIds) const
+{
+    // [[id, state, duration], ...]
+    QVariantList changes;
+    for (int id: clientIds) {
+        Client* client = clientRegistry.findById(id);
+        if (!client) continue;
+        changes.append(QVariant(QVariantList({ client->id(), client->state(), client->user().duration() })));
+    }
+    return changes;
+}
+
+void Server::onClientRetired(Client* client)
+{
+    monitorSnapshot.remove(client);
+}
+
+void Server::onClientAdded(Client* client)
+{
+    monitorSnapshot.update(client);
+    connect(client, SIGNAL(sessionTimeout(User)), SLOT(onClientSessionTimeout(User)));
+    connect(client, SIGNAL(voucherSessionTimeout(QString)), SLOT(onVoucherSessionTimeout(QString)));
+    connect(client, SIGNAL(sessionUpdated()), SLOT(onClientSessionUpdated()));
+}
+
+void Server::onClientRegistryLoaded(int added, int updated, int retired, qint64 elapsed)
+{
+    qWarning() << "Clients loaded:" << added << "added," << updated << "updated,"
+               << retired << "retired in" << elapsed << "ms";
+}
 
-    sendTo(client->connection(), "session-sync", user.duration());
-    sendToClientMonitors("client-session-sync", client->toMap());
+void Server::onTimingWheelTicked(int count, qint64 lag)
+{
+    static Metrics::Series* const fired = Metrics::counter("shiftnet_timer_fired_total");
+    static Metrics::Series* const tickLag = Metrics::gauge("shiftnet_timer_tick_lag_ms");
+    Metrics::increment(fired, count);
+    Metrics::set(tickLag, lag);
 }
 
 // Process message methods (Client)
 
 void Server::processClientInit(Client* client, const QString& state)
 {
-    if (state == "maintenance") {
-        client->startAdminstratorSession();
-    }
-    else {
-        client->resetSession();
+    // sesi dari sebelum server dijalankan ulang dilanjutkan setelah init terkirim
+    const bool resume = client->hasSuspendedSession() && state != "maintenance";
+
+    if (!resume) {
+        if (client->hasSuspendedSession())
+            endSuspendedSession(client, "PC masuk mode pemeliharaan.");
+
+        if (state == "maintenance") {
+            client->startAdminstratorSession();
+        }
+        else {
+            client->resetSession();
+        }
     }
 
     sendTo(client->connection(), "init", QVariantMap({
@@ -232,146 +771,265 @@ void Server::processClientInit(Client* client, const QString& state)
             { "password", QCryptographicHash::hash(settings.value("Client/password").toByteArray(), QCryptographicHash::Sha1).toHex() },
         })}
     }));
-    sendToClientMonitors("client-connected", client->toMap());
+    notifyClientChanged("client-connected", client);
+
+    if (resume)
+        resumeSession(client);
 }
 
 void Server::processClientGuestLogin(Client *client, const QString& username, const QString &voucherCode)
 {
-    VoucherValidator validator;
+    const QPointer<Connection> socket = client->connection();
 
-    if (!validator.isValid(voucherCode, false)) {
-        sendTo(client->connection(), "guest-login-failed", validator.error());
-        return;
-    }
+    // login sebelum init, sesi lama tidak dilanjutkan dan klaimnya dilepas
+    if (client->hasSuspendedSession())
+        endSuspendedSession(client, "PC login ulang sebelum sesi dilanjutkan.");
 
-    const Voucher voucher = validator.voucher();
+    voucherIndex.find(voucherCode, client, [=](const ActiveVoucher& activeVoucher) {
+        if (!socket || client->connection() != socket)
+            return;
 
-    if (!Database::useVoucher(voucher.code(), client->id(), username)) {
-        sendTo(client->connection(), "guest-login-failed", "Kesalahan pada server database.");
-        return;
-    }
+        VoucherValidator validator;
+        if (!validator.isValid(activeVoucher, false)) {
+            sendTo(socket, "guest-login-failed", validator.error());
+            return;
+        }
 
-    client->startGuestSession(username, voucher);
-    Database::logUserActivity(client->id(), client->user(), ACTIVITY_USER_SESSION_START,
-                              QString("Memulai pemakaian voucher %1 durasi %2.").arg(voucher.code(), voucher.durationString()),
-                              voucher.id());
+        const Voucher voucher = validator.voucher();
 
-    User user = client->user();
-    sendTo(client->connection(), "session-start", QVariantMap({
-        { "username", user.username() },
-        { "duration", user.duration() },
-    }));
-    sendToClientMonitors("client-session-start", client->toMap());
+        databaseExecutor.useVoucher(voucher.code(), client->id(), username, client, [=](bool ok) {
+            // koneksi terputus selama query, lepaskan lagi voucher ini saja. Koneksi baru di PC
+            // yang sama mungkin sudah mengantrikan klaimnya sendiri.
+            if (!socket || client->connection() != socket) {
+                if (ok)
+                    databaseExecutor.releaseVoucher(voucher.code(), client->id());
+                return;
+            }
+
+            if (!ok) {
+                // isi indeks mungkin sudah basi, ambil lagi dari database saat dicoba ulang
+                voucherIndex.remove(voucher.code());
+                sendTo(socket, "guest-login-failed", "Kesalahan pada server database.");
+                return;
+            }
+
+            voucherIndex.setUsed(voucher.code(), client->id(), username);
+            client->startGuestSession(username, voucher);
+            journal.append(BillingJournal::SessionStart, client->id(), client->user(), voucher);
+            activityLog.log(client->id(), client->user(), ACTIVITY_USER_SESSION_START,
+                            QString("Memulai pemakaian voucher %1 durasi %2.").arg(voucher.code(), voucher.durationString()),
+                            voucher.id());
+
+            User user = client->user();
+            sendTo(socket, "session-start", QVariantMap({
+                { "username", user.username() },
+                { "duration", user.duration() },
+            }));
+            notifyClientChanged("client-session-start", client);
+        });
+    });
 }
 
 void Server::processClientMemberLogin(Client* client, const QString& username, const QString& password, const QString& voucherCode)
 {
-    QSqlRecord record = Database::findMember(username);
-    if (record.isEmpty()) {
-        sendTo(client->connection(), "member-login-failed", QVariantList({"username", "Nama pengguna tidak ditemukan."}));
-        return;
-    }
+    const QPointer<Connection> socket = client->connection();
 
-    User user = User::createMember(record.value("id").toInt(), record.value("username").toString(), record.value("remainingDuration").toInt());
+    if (client->hasSuspendedSession())
+        endSuspendedSession(client, "PC login ulang sebelum sesi dilanjutkan.");
 
-    if (record.value("password").toString() != password) {
-        sendTo(client->connection(), "member-login-failed", QVariantList({"password", "Kata sandi anda salah."}));
+    const int wait = loginThrottle.attempt(client->id(), username);
+    if (wait > 0) {
+        sendTo(socket, "member-login-failed",
+               QVariantList({"username", QString("Terlalu banyak percobaan login, coba lagi dalam %1 detik.").arg((wait + 999) / 1000)}));
         return;
     }
 
-    // pastikan user aktif
-    if (record.value("active").toBool() != true) {
-        sendTo(client->connection(), "member-login-failed",
-               QVariantList({"username","Akun anda tidak aktif, silahkan hubungi operator."}));
-        return;
-    }
+    memberCache.find(username, client, [=](const QSqlRecord& record) {
+        if (!socket || client->connection() != socket)
+            return;
 
-    // jangan sampai double login
-    int activeClientId = record.value("activeClientId").toInt();
-    if (activeClientId != 0) {
-        sendTo(client->connection(), "member-login-failed",
-               QVariantList({"username", QString("Akun anda sedang login di client %1.").arg(activeClientId)}));
-        return;
-    }
+        if (record.isEmpty()) {
+            sendTo(socket, "member-login-failed", QVariantList({"username", "Nama pengguna tidak ditemukan."}));
+            return;
+        }
 
-    if (!voucherCode.isEmpty()) {
-        VoucherValidator validator;
-        if (!validator.isValid(voucherCode, true)) {
-            sendTo(client->connection(), "member-login-failed", QVariantList({"voucherCode", validator.error() }));
+        const User user = User::createMember(record.value("id").toInt(), record.value("username").toString(), record.value("remainingDuration").toInt());
+
+        if (record.value("password").toString() != password) {
+            sendTo(socket, "member-login-failed", QVariantList({"password", "Kata sandi anda salah."}));
             return;
         }
 
-        const Voucher voucher = validator.voucher();
+        // pastikan user aktif
+        if (record.value("active").toBool() != true) {
+            sendTo(socket, "member-login-failed",
+                   QVariantList({"username","Akun anda tidak aktif, silahkan hubungi operator."}));
+            return;
+        }
 
-        if (!Database::topupMemberVoucher(user.id(), user.duration(), voucher.code(), voucher.duration())) {
-            sendTo(client->connection(), "member-login-failed", QVariantList({"voucherCode", "Kesalahan pada database server."}));
+        // jangan sampai double login
+        int activeClientId = record.value("activeClientId").toInt();
+        if (activeClientId != 0) {
+            sendTo(socket, "member-login-failed",
+                   QVariantList({"username", QString("Akun anda sedang login di client %1.").arg(activeClientId)}));
             return;
         }
 
-        user.addDuration(voucher.duration());
-        Database::logUserActivity(client->id(), user, ACTIVITY_USER_TOPUP,
-                                  QString("Topup voucher %1 durasi %2.").arg(voucher.code(), voucher.durationString()),
-                                  voucher.id());
-    }
+        if (voucherCode.isEmpty()) {
+            startClientMemberSession(client, user);
+            return;
+        }
+
+        voucherIndex.find(voucherCode, client, [=](const ActiveVoucher& activeVoucher) {
+            if (!socket || client->connection() != socket)
+                return;
+
+            VoucherValidator validator;
+            if (!validator.isValid(activeVoucher, true)) {
+                sendTo(socket, "member-login-failed", QVariantList({"voucherCode", validator.error() }));
+                return;
+            }
+
+            const Voucher voucher = validator.voucher();
+
+            // dicatat sebelum query supaya topup yang sudah masuk SQL tidak hilang saat recover
+            journal.append(BillingJournal::TopupPending, client->id(), user, voucher);
+            databaseExecutor.topupMemberVoucher(user.id(), user.duration(), voucher.code(), voucher.duration(), client, [=](bool ok) {
+                // berhasil berarti voucher sudah dihapus, gagal berarti isi indeks mungkin basi
+                voucherIndex.remove(voucher.code());
+                memberCache.invalidate(user.username());
+                if (!ok) {
+                    journal.append(BillingJournal::TopupFailed, client->id(), user, voucher);
+                    sendTo(socket, "member-login-failed", QVariantList({"voucherCode", "Kesalahan pada database server."}));
+                    return;
+                }
+
+                User topupUser = user;
+                topupUser.addDuration(voucher.duration());
+                journal.append(BillingJournal::Topup, client->id(), topupUser, voucher);
+                activityLog.log(client->id(), topupUser, ACTIVITY_USER_TOPUP,
+                                QString("Topup voucher %1 durasi %2.").arg(voucher.code(), voucher.durationString()),
+                                voucher.id());
+
+                if (socket && client->connection() == socket)
+                    startClientMemberSession(client, topupUser);
+            });
+        });
+    });
+}
+
+void Server::startClientMemberSession(Client* client, const User& user)
+{
+    const QPointer<Connection> socket = client->connection();
 
     if (user.duration() <= 0) {
-        sendTo(client->connection(), "member-login-failed", QVariantList({"username", "Sisa waktu habis, silahkan isi voucher!"}));
+        sendTo(socket, "member-login-failed", QVariantList({"username", "Sisa waktu habis, silahkan isi voucher!"}));
         return;
     }
 
-    if (!Database::setMemberClientId(user.id(), client->id())) {
-        sendTo(client->connection(), "member-login-failed", QVariantList({"username", "Kesalahan pada server database."}));
-        return;
-    }
+    databaseExecutor.setMemberClientId(user.id(), client->id(), client, [=](Database::ClaimResult result) {
+        memberCache.invalidate(user.username());
 
-    client->startMemberSession(user);
-    Database::logUserActivity(client->id(), user, ACTIVITY_USER_SESSION_START, "Memulai pemakaian.");
+        // koneksi terputus selama query, lepaskan lagi membernya selama masih diklaim PC ini
+        if (!socket || client->connection() != socket) {
+            if (result == Database::Claimed)
+                databaseExecutor.releaseMember(user.id(), client->id());
+            return;
+        }
 
-    sendTo(client->connection(), "session-start", QVariantMap({
-        { "username", user.username() },
-        { "duration", user.duration() },
-    }));
-    sendToClientMonitors("client-session-start", client->toMap());
+        // login ganda dari PC lain menang lebih dulu
+        if (result == Database::ClaimTaken) {
+            sendTo(socket, "member-login-failed", QVariantList({"username", "Akun anda sedang login di client lain."}));
+            return;
+        }
+
+        if (result != Database::Claimed) {
+            sendTo(socket, "member-login-failed", QVariantList({"username", "Kesalahan pada server database."}));
+            return;
+        }
+
+        loginThrottle.reset(client->id(), user.username());
+        client->startMemberSession(user);
+        journal.append(BillingJournal::SessionStart, client->id(), user, Voucher());
+        activityLog.log(client->id(), user, ACTIVITY_USER_SESSION_START, "Memulai pemakaian.");
+
+        sendTo(socket, "session-start", QVariantMap({
+            { "username", user.username() },
+            { "duration", user.duration() },
+        }));
+        notifyClientChanged("client-session-start", client);
+    });
 }
 
 void Server::processClientMaintenanceStart(Client* client)
 {
     client->startAdminstratorSession();
-    Database::logUserActivity(client->id(), client->user(), ACTIVITY_MAINTENANCE_START, "Pemeliharaan dimulai.");
-    sendToClientMonitors("client-maintenance-started", client->toMap());
+    activityLog.log(client->id(), client->user(), ACTIVITY_MAINTENANCE_START, "Pemeliharaan dimulai.");
+    notifyClientChanged("client-maintenance-started", client);
 }
 
 void Server::processClientMaintenanceStop(Client* client)
 {
-    Database::logUserActivity(client->id(), client->user(), ACTIVITY_MAINTENANCE_STOP, "Pemeliharaan selesai.");
+    activityLog.log(client->id(), client->user(), ACTIVITY_MAINTENANCE_STOP, "Pemeliharaan selesai.");
     client->resetSession();
-    sendToClientMonitors("client-maintenance-finished", client->toMap());
+    notifyClientChanged("client-maintenance-finished", client);
 }
 
 void Server::processClientUserTopup(Client* client, const QString& voucherCode)
 {
-    VoucherValidator validator;
-    User user = client->user();
+    const QPointer<Connection> socket = client->connection();
+    const User user = client->user();
 
-    if (!validator.isValid(voucherCode, user.isMember())) {
-        sendTo(client->connection(), "user-topup-failed", validator.error());
-        return;
-    }
+    voucherIndex.find(voucherCode, client, [=](const ActiveVoucher& activeVoucher) {
+        if (!socket || client->connection() != socket)
+            return;
 
-    const Voucher voucher = validator.voucher();
+        VoucherValidator validator;
+        if (!validator.isValid(activeVoucher, user.isMember())) {
+            sendTo(socket, "user-topup-failed", validator.error());
+            return;
+        }
 
-    if (!Database::topupVoucher(client->id(), user, voucher)) {
-        sendTo(client->connection(), "user-topup-failed", "Kesalahan pada server database.");
-        return;
-    }
+        const Voucher voucher = validator.voucher();
+        const User currentUser = client->user();
 
-    client->topupVoucher(voucher);
+        if (currentUser.isMember())
+            journal.append(BillingJournal::TopupPending, client->id(), currentUser, voucher);
 
-    Database::logUserActivity(client->id(), user, ACTIVITY_USER_TOPUP,
-                              QString("Topup voucher %1 durasi %2").arg(voucher.code(), voucher.durationString()),
-                              voucher.id());
+        databaseExecutor.topupVoucher(client->id(), currentUser, voucher, client, [=](bool ok) {
+            if (!ok || currentUser.isMember())
+                voucherIndex.remove(voucher.code());
+            else
+                voucherIndex.setUsed(voucher.code(), client->id(), currentUser.username());
 
-    sendTo(client->connection(), "user-topup-success", voucher.duration());
+            if (!ok) {
+                if (currentUser.isMember())
+                    journal.append(BillingJournal::TopupFailed, client->id(), currentUser, voucher);
+                sendTo(socket, "user-topup-failed", "Kesalahan pada server database.");
+                return;
+            }
+
+            activityLog.log(client->id(), currentUser, ACTIVITY_USER_TOPUP,
+                            QString("Topup voucher %1 durasi %2").arg(voucher.code(), voucher.durationString()),
+                            voucher.id());
+
+            // sesi sudah berganti selama query
+            const User sessionUser = client->user();
+            if (!socket || client->connection() != socket || sessionUser.group() != currentUser.group()
+                    || sessionUser.username() != currentUser.username()) {
+                // hanya voucher topup ini, voucher sesi baru di PC ini tetap dipakai
+                if (currentUser.isGuest()) {
+                    voucherIndex.release(voucher.code(), client->id());
+                    databaseExecutor.releaseVoucher(voucher.code(), client->id());
+                }
+                return;
+            }
+
+            client->topupVoucher(voucher);
+            journal.append(BillingJournal::Topup, client->id(), client->user(), voucher);
+            sendTo(socket, "user-topup-success", voucher.duration());
+        });
+    });
 }
 
 void Server::processClientSessionStop(Client* client)
@@ -380,120 +1038,400 @@ void Server::processClientSessionStop(Client* client)
     const Voucher voucher = client->activeVoucher();
     QString activityInfo;
 
-    Database::transaction();
+    journal.append(BillingJournal::SessionStop, client->id(), user, voucher);
+    flushClientDuration(client);
+
     if (user.isGuest()) {
-        Database::resetVoucherClientState(client->id());
-        const Voucher voucher = client->activeVoucher();
+        releaseClientVouchers(client->id());
         activityInfo = QString("Kode voucher: %1, Sisa Waktu: %2.").arg(voucher.code(), voucher.durationString());
     }
     else if (user.isMember()) {
-        Database::resetMemberClientState(user.id());
+        releaseMember(user);
         activityInfo = QString("Sisa Waktu: %1.").arg(Voucher("", user.duration()).durationString());
     }
-    Database::logUserActivity(client->id(), user, ACTIVITY_USER_SESSION_STOP, "Sesi pemakaian dihentikan. " + activityInfo,
-                              voucher.id());
-    Database::commit();
+    activityLog.log(client->id(), user, ACTIVITY_USER_SESSION_STOP, "Sesi pemakaian dihentikan. " + activityInfo,
+                    voucher.id());
 
     client->resetSession();
     sendTo(client->connection(), "session-stop");
-    sendToClientMonitors("client-session-stop", client->toMap());
+    notifyClientChanged("client-session-stop", client);
 }
 
-void Server::processClientMessage(QWebSocket* socket, const QString& type, const QVariant& message)
+void Server::flushClientDuration(Client* client)
 {
-    Client* client = clientsByIds.value(socket->property("client-id").toInt());
-    if (type == "init") {
-        processClientInit(client, message.toString());
+    const User user = client->user();
+    if (user.isMember())
+        durationWriter.flushMember(user.id());
+    else if (user.isGuest())
+        durationWriter.flushVoucher(client->activeVoucher().code());
+}
+
+void Server::releaseClientVouchers(int clientId)
+{
+    voucherIndex.releaseClient(clientId);
+    databaseExecutor.resetVoucherClientState(clientId);
+}
+
+void Server::releaseMember(const User& user)
+{
+    memberCache.invalidate(user.username());
+    databaseExecutor.resetMemberClientState(user.id());
+}
+
+void Server::processClientMessage(Connection* socket, const QString& type, const QVariant& message)
+{
+    Client* client = clientRegistry.findById(socket->property("client-id").toInt());
+    if (!client)
+        return;
+
+    bool valid = true;
+
+    switch (Message::clientMessageType(type)) {
+    case Message::ClientInit: {
+        ClientInitMessage init;
+        if ((valid = init.decode(message)))
+            processClientInit(client, init.state);
+        break;
     }
-    else if (type == "guest-login") {
-        const QStringList messages = message.toStringList();
-        processClientGuestLogin(client, messages.at(0), messages.at(1));
+    case Message::GuestLogin: {
+        GuestLoginMessage login;
+        if ((valid = login.decode(message)))
+            processClientGuestLogin(client, login.username, login.voucherCode);
+        break;
     }
-    else if (type == "member-login") {
-        const QStringList messages = message.toStringList();
-        processClientMemberLogin(client, messages.at(0), messages.at(1), messages.at(2));
+    case Message::MemberLogin: {
+        MemberLoginMessage login;
+        if ((valid = login.decode(message)))
+            processClientMemberLogin(client, login.username, login.password, login.voucherCode);
+        break;
     }
-    else if (type == "session-stop") {
+    case Message::SessionStop:
         processClientSessionStop(client);
+        break;
+    case Message::UserTopup: {
+        UserTopupMessage topup;
+        if ((valid = topup.decode(message)))
+            processClientUserTopup(client, topup.voucherCode);
+        break;
     }
-    else if (type == "user-topup") {
-        processClientUserTopup(client, message.toString());
-    }
-    else if (type == "maintenance-start") {
+    case Message::MaintenanceStart:
         processClientMaintenanceStart(client);
-    }
-    else if (type == "maintenance-stop") {
+        break;
+    case Message::MaintenanceStop:
         processClientMaintenanceStop(client);
+        break;
+    default:
+        qWarning() << "Unknown client message:" << qPrintable(type);
+        break;
     }
+
+    if (!valid)
+        qWarning() << "Invalid client message payload:" << qPrintable(type) << "from client" << client->id();
 }
 
 // Process message methods (ClientMonitor)
 
-void Server::processClientMonitorMessage(QWebSocket* connection, const QString& msgType, const QVariant& message)
+void Server::processClientMonitorMessage(Connection* connection, const QString& msgType, const QVariant& message)
 {
-    if (msgType == "init") {
-        QVariantList clientList;
-        for (Client* client: clients) {
-            clientList.append(client->toMap());
-        }
+    bool valid = true;
 
-        sendTo(connection, "init", QVariantMap({
-            { "company", QVariantMap({
-                { "name", settings.value("Company/name") },
-                { "address", settings.value("Company/address") },
-            })},
-            { "clients", clientList }
-        }));
+    switch (Message::monitorMessageType(msgType)) {
+    case Message::MonitorInit: {
+        MonitorInitMessage init;
+        if ((valid = init.decode(message)))
+            processClientMonitorInit(connection, init);
+        break;
+    }
+    case Message::StopSessions: {
+        ClientIdsMessage stop;
+        if ((valid = stop.decode(message)))
+            processClientMonitorStopSessions(connection, stop.ids);
+        break;
+    }
+    case Message::ReloadClients:
+        reloadClients();
+        break;
+    case Message::TraceStart:
+    case Message::TraceStop:
+    case Message::TraceDump:
+        processClientMonitorTrace(connection, Message::monitorMessageType(msgType));
+        break;
+    case Message::ShutdownClients:
+    case Message::RestartClients: {
+        ClientIdsMessage system;
+        if ((valid = system.decode(message)))
+            processClientMonitorSystemCommand(system.ids, "system-" + msgType.split("-").first());
+        break;
+    }
+    default:
+        qWarning() << "Unknown client-monitor message:" << qPrintable(msgType);
+        break;
     }
-    else if (msgType == "stop-sessions") {
-        for (const QVariant id: message.toList()) {
-            Client* client = clientsByIds.value(id.toInt());
-            if (!(client && client->connection())) continue;
 
-            if (client->state() == Client::Used)
-                processClientSessionStop(client);
-            else if (client->state() == Client::Maintenance) {
-                sendTo(client->connection(), "maintenance-remote-stop");
-                processClientMaintenanceStop(client);
+    if (!valid)
+        qWarning() << "Invalid client-monitor message payload:" << qPrintable(msgType);
+}
+
+void Server::processClientMonitorInit(Connection* connection, const MonitorInitMessage& init)
+{
+    if (init.clientsSync && !clientsSyncMonitorSockets.contains(connection))
+        clientsSyncMonitorSockets.append(connection);
+    if (init.aggregateStops && !aggregateStopMonitorSockets.contains(connection))
+        aggregateStopMonitorSockets.append(connection);
+    if (init.sequenced && !sequencedMonitorSockets.contains(connection))
+        sequencedMonitorSockets.append(connection);
+
+    if (resumeClientMonitor(connection, init))
+        return;
+
+    // frame yang sama dan hasil encode-nya dipakai selama tidak ada perubahan
+    sendFrame(connection, monitorSnapshot.frame(monitorEvents));
+}
+
+bool Server::resumeClientMonitor(Connection* connection, const MonitorInitMessage& init)
+{
+    // perubahan durasi hanya tercatat sebagai clients-sync, monitor lama selalu mulai dari snapshot
+    if (!init.clientsSync || !init.resumeFrom || init.stream != monitorEvents.stream())
+        return false;
+
+    QList<Frame> frames;
+    if (!monitorEvents.since(init.resumeFrom, &frames))
+        return false;
+
+    // replay yang lebih besar dari antrian keluar akan memutus monitor, snapshot lebih murah
+    qint64 size = 0;
+    for (const Frame& frame: frames) {
+        size += frame.data(connection->format()).size();
+        if (size > monitorReplayLimit)
+            return false;
+    }
+
+    sendFrame(connection, Frame("resume", QVariantMap({
+        { "stream", monitorEvents.stream() },
+        { "from", init.resumeFrom },
+        { "sequence", monitorEvents.lastSequence() },
+    })));
+
+    for (const Frame& frame: frames)
+        sendFrame(connection, frame);
+
+    Metrics::increment("shiftnet_monitor_resumes_total");
+    Metrics::increment("shiftnet_monitor_replayed_events_total", QString(), frames.size());
+    return true;
+}
+
+void Server::processClientMonitorStopSessions(Connection* connection, const QList<int>& clientIds)
+{
+    // semua PC diproses di memori dulu, database cukup satu transaksi dan monitor satu event
+    QHash<int, int> members;
+    QHash<QString, int> vouchers;
+    QList<int> voucherClientIds;
+    QList<int> memberIds;
+    QHash<QString, int> voucherClients;
+    QHash<int, int> memberClients;
+    QList<Activity> activities;
+    QVariantList stopped;
+    QStringList stoppedTypes;
+    QVariantList results;
+
+    for (int id: clientIds) {
+        Client* client = clientRegistry.findById(id);
+        QString result;
+
+        if (!client)
+            result = "not-found";
+        else if (!client->connection())
+            result = "offline";
+        else if (client->state() == Client::Used) {
+            const User user = client->user();
+            const Voucher voucher = client->activeVoucher();
+            QString activityInfo;
+
+            journal.append(BillingJournal::SessionStop, id, user, voucher);
+
+            if (user.isGuest()) {
+                vouchers.insert(voucher.code(), voucher.duration());
+                durationWriter.discardVoucher(voucher.code());
+                for (const QString& code: voucherIndex.releaseClient(id))
+                    voucherClients.insert(code, id);
+                voucherClientIds << id;
+                activityInfo = QString("Kode voucher: %1, Sisa Waktu: %2.").arg(voucher.code(), voucher.durationString());
             }
+            else if (user.isMember()) {
+                members.insert(user.id(), user.duration());
+                durationWriter.discardMember(user.id());
+                memberCache.invalidate(user.username());
+                memberIds << user.id();
+                memberClients.insert(user.id(), id);
+                activityInfo = QString("Sisa Waktu: %1.").arg(Voucher("", user.duration()).durationString());
+            }
+            activities << Activity(id, user, ACTIVITY_USER_SESSION_STOP, "Sesi pemakaian dihentikan. " + activityInfo,
+                                   voucher.id());
+
+            client->resetSession();
+            sendTo(client->connection(), "session-stop");
+            result = "stopped";
+        }
+        else if (client->state() == Client::Maintenance) {
+            activities << Activity(id, client->user(), ACTIVITY_MAINTENANCE_STOP, "Pemeliharaan selesai.");
+
+            sendTo(client->connection(), "maintenance-remote-stop");
+            client->resetSession();
+            result = "maintenance-stopped";
+        }
+        else
+            result = "idle";
+
+        if (result == "stopped" || result == "maintenance-stopped") {
+            monitorSnapshot.update(client);
+            stopped << client->toMap();
+            stoppedTypes << (result == "stopped" ? "client-session-stop" : "client-maintenance-finished");
         }
+
+        results << QVariantMap({
+            { "id", id },
+            { "result", result },
+        });
+    }
+
+    // monitor lama tetap menerima event per PC, yang memilih aggregateStops cukup satu event
+    // dengan nomor urut event per PC terakhir supaya resume tetap mulai dari tempat yang benar
+    if (!stopped.isEmpty()) {
+        quint64 sequence = 0;
+        for (int i = 0; i < stopped.size(); i++)
+            sequence = sendToClientMonitors(stoppedTypes.at(i), stopped.at(i), aggregateStopMonitorSockets);
+
+        const Frame frame("clients-session-stop", stopped, sequence);
+        const Frame plainFrame("clients-session-stop", stopped);
+        const QList<Connection*> sockets = aggregateStopMonitorSockets;
+        for (Connection* socket: sockets)
+            sendFrame(socket, isSequenced(socket) ? frame : plainFrame);
     }
-    else if (msgType == "shutdown-clients" || msgType == "restart-clients") {
-        for (const QVariant id: message.toList()) {
-            Client* client = clientsByIds.value(id.toInt());
-            if (!(client && client->connection())) continue;
-            if (client->state() == Client::Offline) continue;
-            sendTo(client->connection(), "system-" + msgType.split("-").first());
+
+    if (activities.isEmpty()) {
+        sendTo(connection, "stop-sessions-result", QVariantMap({
+            { "results", results },
+            { "persisted", true },
+        }));
+        return;
+    }
+
+    const QPointer<Connection> monitor = connection;
+
+    databaseExecutor.stopSessions(members, vouchers, voucherClientIds, memberIds, activities, this,
+                                  [=](bool ok) {
+        if (!ok) {
+            // sesi sudah berhenti di memori, tulis ulang lewat jalur per PC. Hanya voucher dan
+            // member yang dihentikan, dan hanya jika PC itu belum memulai sesi baru.
+            durationWriter.restore(members, vouchers);
+            durationWriter.flush();
+            for (QHash<QString, int>::const_iterator it = voucherClients.constBegin(); it != voucherClients.constEnd(); ++it) {
+                Client* client = clientRegistry.findById(it.value());
+                if (!client || client->state() != Client::Used)
+                    databaseExecutor.releaseVoucher(it.key(), it.value());
+            }
+            for (QHash<int, int>::const_iterator it = memberClients.constBegin(); it != memberClients.constEnd(); ++it) {
+                Client* client = clientRegistry.findById(it.value());
+                if (!client || client->state() != Client::Used)
+                    databaseExecutor.releaseMember(it.key(), it.value());
+            }
+            for (const Activity& activity: activities)
+                activityLog.log(activity);
+
+            Metrics::increment("shiftnet_stop_sessions_fallbacks_total");
         }
+
+        if (monitor)
+            sendTo(monitor, "stop-sessions-result", QVariantMap({
+                { "results", results },
+                { "persisted", ok },
+            }));
+    });
+}
+
+void Server::processClientMonitorSystemCommand(const QList<int>& clientIds, const QString& command)
+{
+    for (int id: clientIds) {
+        Client* client = clientRegistry.findById(id);
+        if (!(client && client->connection())) continue;
+        if (client->state() == Client::Offline) continue;
+        sendTo(client->connection(), command);
     }
 }
 
 // Send message methods
-void Server::sendToClientMonitors(const QString& type, const QVariant& data)
+quint64 Server::encodedBytes() const
+{
+    return Frame::encodeStats(Frame::Json).bytes + Frame::encodeStats(Frame::Cbor).bytes;
+}
+
+void Server::processClientMonitorTrace(Connection* connection, Message::Type type)
+{
+    if (type == Message::TraceStart || type == Message::TraceStop) {
+        Trace::setEnabled(type == Message::TraceStart);
+        sendTo(connection, "trace-state", Trace::isEnabled());
+        return;
+    }
+
+    dumpTrace(connection);
+}
+
+void Server::notifyClientChanged(const QString& type, Client* client)
 {
-    for (QWebSocket* socket: clientMonitorSockets)
-        sendTo(socket, type, data);
+    monitorSnapshot.update(client);
+    sendToClientMonitors(type, client->toMap());
+}
+
+quint64 Server::sendToClientMonitors(const QString& type, const QVariant& data, const QList<Connection*>& excluded)
+{
+    // dicatat walau tidak ada monitor, monitor yang tersambung ulang meminta dari log
+    const Frame frame = monitorEvents.append(type, data);
+    const Frame plainFrame(type, data);
+
+    const QList<Connection*> sockets = clientMonitorSockets;
+    for (Connection* socket: sockets) {
+        if (!excluded.contains(socket))
+            sendFrame(socket, isSequenced(socket) ? frame : plainFrame);
+    }
+
+    return frame.sequence();
+}
+
+bool Server::isSequenced(Connection* socket) const
+{
+    // monitor lama tetap menerima [type, message]. Monitor yang melewatkan clients-sync tidak
+    // boleh menerima nomor urut sesudah celahnya sampai clients-sync lengkap terkirim.
+    return sequencedMonitorSockets.contains(socket) && !staleClientsSyncSockets.contains(socket);
 }
 
 void Server::sendToClients(const QString& type, const QVariant& data)
 {
-    for (QWebSocket* socket: clientSockets)
-        sendTo(socket, type, data);
+    if (clientSockets.isEmpty())
+        return;
+
+    const Frame frame(type, data);
+
+    for (Connection* socket: clientSockets)
+        sendFrame(socket, frame);
 }
 
-void Server::sendTo(QWebSocket* socket, const QString& type, const QVariant& message)
+void Server::sendTo(Connection* socket, const QString& type, const QVariant& message)
 {
-    QString textMessage = QJsonDocument::fromVariant(QVariantList({ type, message })).toJson(QJsonDocument::Compact);
-    socket->sendTextMessage(textMessage);
-    socket->flush();
+    const Frame frame(type, message);
+    sendFrame(socket, frame);
 }
 
-// Common helper methods
-Client* Server::findClient(const QHostAddress& address)
+void Server::sendFrame(Connection* socket, const Frame& frame, const QString& coalesceKey)
 {
-    QString addr = address.toString().split(":").last();
-    for (Client* client: clients)
-        if (client->hostAddress() == addr)
-            return client;
-    return 0;
+    Metrics::Series* series = 0;
+    if (Metrics::isEnabled() || Trace::isEnabled()) {
+        Metrics::Series*& cached = sendSeries[frame.type()];
+        if (!cached)
+            cached = Metrics::summary("shiftnet_send_seconds", Metrics::label("type", frame.type()));
+        series = cached;
+    }
+
+    MetricsTimer timer(series);
+    if (socket)
+        socket->send(frame, coalesceKey);
 }
@@ -3,15 +3,33 @@
 
 #include <QObject>
 #include <QSettings>
-#include <QWebSocketServer>
-#include <QWebSocket>
-
-class QWebSocket;
+#include <QTimer>
+#include <QSet>
+#include <QHash>
+
+#include "timingwheel.h"
+#include "databaseexecutor.h"
+#include "durationwriter.h"
+#include "billingjournal.h"
+#include "activitylog.h"
+#include "clientregistry.h"
+#include "voucherindex.h"
+#include "membercache.h"
+#include "loginthrottle.h"
+#include "outboundqueue.h"
+#include "socketserver.h"
+#include "metricsserver.h"
+#include "monitorsnapshot.h"
+#include "monitoreventlog.h"
+#include "messages.h"
+#include "metrics.h"
 
 namespace shiftnet {
 
 class User;
 class Client;
+class Frame;
+class Connection;
 
 class Server : public QObject
 {
@@ -20,23 +38,50 @@ public:
     explicit Server(QObject *parent = 0);
     bool start();
 
+    quint64 encodedBytes() const;
+    inline quint64 sentBytes() const { return OutboundQueue::totalSentBytes(); }
+
 private slots:
-    void onWebSocketConnected();
-    void onWebSocketDisconnected();
-    void onWebSocketTextMessageReceived(const QString& message);
+    void onWebSocketConnected(quint64 connectionId, const QString& peerAddress);
+    void onWebSocketDisconnected(quint64 connectionId);
+    void onWebSocketMessageReceived(quint64 connectionId, const QVariantList& message, int format);
+    void onWebSocketMessageRejected(quint64 connectionId, const QString& reason);
+    void onWebSocketBacklogChanged(quint64 connectionId, bool backlogged);
 
     void onClientSessionTimeout(const User& user);
     void onClientSessionUpdated();
     void onVoucherSessionTimeout(const QString& code);
 
+    void onClientAdded(Client* client);
+    void onClientRetired(Client* client);
+    void onClientRegistryLoaded(int added, int updated, int retired, qint64 elapsed);
+    void reloadClients();
+
+    void onTimingWheelTicked(int count, qint64 lag);
+    void saveSessionSnapshot();
+    void updateMetrics();
+    void onTraceSignal();
+    void expireSuspendedSessions();
+    void flushClientsSync();
+
 private:
-    void processClientMessage(QWebSocket* socket, const QString& type, const QVariant& message);
-    void processClientMonitorMessage(QWebSocket* socket, const QString& type, const QVariant& message);
+    struct MessageMetrics {
+        Metrics::Series* count;
+        Metrics::Series* handler;
+    };
+
+    void processMessage(Connection* socket, const QVariantList& data);
+    MessageMetrics messageMetrics(const QString& clientType, Message::Type messageType, const QString& type);
+    void closeConnection(Connection* socket, const QString& reason);
+
+    void processClientMessage(Connection* socket, const QString& type, const QVariant& message);
+    void processClientMonitorMessage(Connection* socket, const QString& type, const QVariant& message);
 
     void processClientInit(Client* client, const QString& state);
     void processClientGuestLogin(Client* client, const QString& username, const QString& code);
     void processClientMemberLogin(Client* client, const QString& username, const QString& password,
                                   const QString& voucherCode);
+    void startClientMemberSession(Client* client, const User& user);
     void processClientSessionStop(Client* client);
 
     void processClientMaintenanceStart(Client* client);
@@ -44,19 +89,64 @@ private:
 
     void processClientUserTopup(Client* client, const QString& voucherCode);
 
-    void sendToClientMonitors(const QString& type, const QVariant& message);
+    void processClientMonitorInit(Connection* connection, const MonitorInitMessage& init);
+    bool resumeClientMonitor(Connection* connection, const MonitorInitMessage& init);
+    void processClientMonitorStopSessions(Connection* connection, const QList<int>& clientIds);
+    void processClientMonitorSystemCommand(const QList<int>& clientIds, const QString& command);
+    void processClientMonitorTrace(Connection* connection, Message::Type type);
+    void dumpTrace(Connection* connection = 0);
+
+    bool recoverJournal(QHash<int, int>* members, QHash<QString, int>* vouchers);
+    void restoreSessions(const QHash<int, int>& journalMembers, const QHash<QString, int>& journalVouchers);
+    void resumeSession(Client* client);
+    void endSuspendedSession(Client* client, const QString& reason);
+
+    void flushClientDuration(Client* client);
+    void releaseClientVouchers(int clientId);
+    void releaseMember(const User& user);
+
+    void notifyClientChanged(const QString& type, Client* client);
+    quint64 sendToClientMonitors(const QString& type, const QVariant& message,
+                                 const QList<Connection*>& excluded = QList<Connection*>());
     void sendToClients(const QString& type, const QVariant& message);
-    void sendTo(QWebSocket* socket, const QString& type, const QVariant& message = QVariant());
-
-    Client* findClient(const QHostAddress& address);
+    void sendTo(Connection* socket, const QString& type, const QVariant& message = QVariant());
+    void sendFrame(Connection* socket, const Frame& frame, const QString& coalesceKey = QString());
+    bool isSequenced(Connection* socket) const;
+    QVariantList clientsSyncChanges(const QList<int>& clientIds) const;
 
 private:
     QSettings settings;
-    QWebSocketServer webSocketServer;
-    QList<Client*> clients;
-    QList<QWebSocket*> clientMonitorSockets;
-    QList<QWebSocket*> clientSockets;
-    QHash<int, Client*> clientsByIds;
+    SocketServer socketServer;
+    TimingWheel timingWheel;
+    DatabaseExecutor databaseExecutor;
+    BillingJournal journal;
+    DurationWriter durationWriter;
+    ActivityLog activityLog;
+    ClientRegistry clientRegistry;
+    VoucherIndex voucherIndex;
+    MemberCache memberCache;
+    LoginThrottle loginThrottle;
+    QTimer clientsReloadTimer;
+    QList<Connection*> clientMonitorSockets;
+    QList<Connection*> clientsSyncMonitorSockets;
+    QList<Connection*> aggregateStopMonitorSockets;
+    QList<Connection*> sequencedMonitorSockets;
+    QList<Connection*> clientSockets;
+    QSet<int> pendingClientsSyncIds;
+    QSet<Connection*> staleClientsSyncSockets;
+    QHash<quint64, Connection*> connections;
+    QTimer clientsSyncTimer;
+    MonitorSnapshot monitorSnapshot;
+    MonitorEventLog monitorEvents;
+    qint64 monitorReplayLimit;
+    QTimer sessionSnapshotTimer;
+    QString sessionSnapshotFile;
+    QTimer metricsTimer;
+    MetricsServer metricsServer;
+    QHash<int, MessageMetrics> messageSeries;
+    QHash<QString, Metrics::Series*> sendSeries;
+    QString traceFile;
+    bool traceDumping;
 };
 
 }
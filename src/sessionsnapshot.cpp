@@ -0,0 +1,121 @@
+#include "sessionsnapshot.h"
+#include "client.h"
+
+#include <QSaveFile>
+#include <QFile>
+#include <QDataStream>
+#include <QDebug>
+
+using namespace shiftnet;
+
+namespace {
+
+const quint32 Magic = 0x534e5353; // "SNSS"
+const quint16 Version = 1;
+
+void writeVoucher(QDataStream& stream, const Voucher& voucher)
+{
+    stream << voucher.code() << qint32(voucher.duration()) << quint64(voucher.id());
+}
+
+Voucher readVoucher(QDataStream& stream)
+{
+    QString code;
+    qint32 duration;
+    quint64 id;
+    stream >> code >> duration >> id;
+    return Voucher(code, duration, id);
+}
+
+}
+
+bool SessionSnapshot::save(const QString& fileName, const QList<Client*>& clients)
+{
+    QList<Client*> sessions;
+    for (Client* client: clients) {
+        const User user = client->user();
+        if (user.isGuest() || user.isMember())
+            sessions << client;
+    }
+
+    // ditulis ke file sementara lalu diganti, snapshot lama tetap utuh jika gagal
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Session snapshot failed:" << qPrintable(file.errorString());
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << Magic << Version << QDateTime::currentDateTimeUtc() << qint32(sessions.size());
+
+    for (Client* client: sessions) {
+        const User user = client->user();
+        stream << qint32(client->id()) << qint32(user.group()) << quint32(user.id())
+               << user.username() << qint32(user.duration());
+        writeVoucher(stream, client->activeVoucher());
+
+        const QList<Voucher> vouchers = client->queuedVouchers();
+        stream << qint32(vouchers.size());
+        for (const Voucher& voucher: vouchers)
+            writeVoucher(stream, voucher);
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Session snapshot failed:" << qPrintable(file.errorString());
+        return false;
+    }
+
+    return true;
+}
+
+bool SessionSnapshot::load(const QString& fileName, QList<Session>* sessions, QDateTime* dateTime)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic;
+    quint16 version;
+    qint32 count;
+    stream >> magic >> version;
+    if (magic != Magic || version != Version) {
+        qWarning() << "Session snapshot ignored: unknown format";
+        return false;
+    }
+
+    stream >> *dateTime >> count;
+
+    QList<Session> result;
+    for (int i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        qint32 clientId, group, duration, voucherCount;
+        quint32 userId;
+        QString username;
+        stream >> clientId >> group >> userId >> username >> duration;
+
+        Session session;
+        session.clientId = clientId;
+        if (group == User::Member)
+            session.user = User::createMember(userId, username, duration);
+        else
+            session.user = User::createGuest(username, duration);
+        session.activeVoucher = readVoucher(stream);
+
+        stream >> voucherCount;
+        for (int j = 0; j < voucherCount && stream.status() == QDataStream::Ok; j++)
+            session.vouchers << readVoucher(stream);
+
+        result << session;
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Session snapshot ignored: file is truncated";
+        return false;
+    }
+
+    *sessions = result;
+    return true;
+}
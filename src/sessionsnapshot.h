@@ -0,0 +1,35 @@
+#ifndef SESSIONSNAPSHOT_H
+#define SESSIONSNAPSHOT_H
+
+#include <QList>
+#include <QDateTime>
+
+#include "user.h"
+#include "voucher.h"
+
+namespace shiftnet {
+
+class Client;
+
+// Salinan sesi yang sedang berjalan di setiap PC, disimpan berkala ke file
+// supaya sesi bisa dilanjutkan setelah server dijalankan ulang.
+class SessionSnapshot
+{
+public:
+    struct Session {
+        int clientId;
+        User user;
+        Voucher activeVoucher;
+        QList<Voucher> vouchers;
+    };
+
+    static bool save(const QString& fileName, const QList<Client*>& clients);
+    static bool load(const QString& fileName, QList<Session>* sessions, QDateTime* dateTime);
+
+private:
+    SessionSnapshot();
+};
+
+}
+
+#endif // SESSIONSNAPSHOT_H
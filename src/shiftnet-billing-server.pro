@@ -1,14 +1,38 @@
 TARGET = shiftnet-billing-server
 TEMPLATE = app
 DESTDIR = $$PWD/../dist
-QT = core websockets sql
+QT = core network websockets sql
+# build untuk load generator: qmake "DEFINES+=SHIFTNET_SEAT_ADDRESS_HEADER"
 SOURCES += \
     main.cpp \
     client.cpp \
     server.cpp \
     database.cpp \
     vouchervalidator.cpp \
-    voucher.cpp
+    voucher.cpp \
+    timingwheel.cpp \
+    durationwriter.cpp \
+    activitylog.cpp \
+    databaseexecutor.cpp \
+    frame.cpp \
+    messages.cpp \
+    clientregistry.cpp \
+    activevoucher.cpp \
+    voucherindex.cpp \
+    membercache.cpp \
+    loginthrottle.cpp \
+    sessionsnapshot.cpp \
+    outboundqueue.cpp \
+    connection.cpp \
+    ioshard.cpp \
+    socketserver.cpp \
+    metrics.cpp \
+    metricsserver.cpp \
+    trace.cpp \
+    billingjournal.cpp \
+    journalsyncer.cpp \
+    monitorsnapshot.cpp \
+    monitoreventlog.cpp
 
 HEADERS  += \
     global.h \
@@ -17,5 +41,29 @@ HEADERS  += \
     user.h \
     voucher.h \
     database.h \
-    vouchervalidator.h
+    vouchervalidator.h \
+    timingwheel.h \
+    durationwriter.h \
+    activity.h \
+    activitylog.h \
+    databaseexecutor.h \
+    frame.h \
+    messages.h \
+    clientregistry.h \
+    activevoucher.h \
+    voucherindex.h \
+    membercache.h \
+    loginthrottle.h \
+    sessionsnapshot.h \
+    outboundqueue.h \
+    connection.h \
+    ioshard.h \
+    socketserver.h \
+    metricsserver.h \
+    metrics.h \
+    trace.h \
+    billingjournal.h \
+    journalsyncer.h \
+    monitorsnapshot.h \
+    monitoreventlog.h
 
@@ -0,0 +1,67 @@
+#include "socketserver.h"
+#include "ioshard.h"
+
+#include <QThread>
+
+using namespace shiftnet;
+
+SocketServer::SocketServer(QObject* parent)
+    : QTcpServer(parent)
+    , _nextShard(0)
+{
+}
+
+SocketServer::~SocketServer()
+{
+    stop();
+}
+
+void SocketServer::start(int threadCount, qint64 highWatermark, qint64 queueLimit, const QByteArray& seatAddressHeader)
+{
+    for (int i = 0; i < qMax(1, threadCount); i++) {
+        QThread* thread = new QThread;
+        thread->setObjectName(QString("io-%1").arg(i));
+
+        IoShard* shard = new IoShard(i, highWatermark, queueLimit);
+        shard->setSeatAddressHeader(seatAddressHeader);
+        shard->moveToThread(thread);
+        thread->start();
+
+        _threads << thread;
+        _shards << shard;
+    }
+}
+
+void SocketServer::stop()
+{
+    close();
+
+    for (QThread* thread: _threads) {
+        thread->quit();
+        thread->wait();
+    }
+
+    // thread sudah berhenti, aman dihapus dari sini
+    qDeleteAll(_shards);
+    qDeleteAll(_threads);
+    _shards.clear();
+    _threads.clear();
+}
+
+int SocketServer::connectionCount() const
+{
+    int count = 0;
+    for (IoShard* shard: _shards)
+        count += shard->connectionCount();
+    return count;
+}
+
+void SocketServer::incomingConnection(qintptr socketDescriptor)
+{
+    if (_shards.isEmpty())
+        return;
+
+    IoShard* shard = _shards.at(_nextShard);
+    _nextShard = (_nextShard + 1) % _shards.size();
+    shard->accept(socketDescriptor);
+}
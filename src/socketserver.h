@@ -0,0 +1,40 @@
+#ifndef SOCKETSERVER_H
+#define SOCKETSERVER_H
+
+#include <QTcpServer>
+#include <QList>
+
+class QThread;
+
+namespace shiftnet {
+
+class IoShard;
+
+// Menerima koneksi TCP di thread utama lalu membagikannya bergiliran ke
+// beberapa IoShard, masing-masing dengan thread dan event loop sendiri.
+class SocketServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    explicit SocketServer(QObject* parent = 0);
+    ~SocketServer();
+
+    void start(int threadCount, qint64 highWatermark, qint64 queueLimit, const QByteArray& seatAddressHeader = QByteArray());
+    void stop();
+
+    inline const QList<IoShard*>& shards() const { return _shards; }
+    int connectionCount() const;
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) Q_DECL_OVERRIDE;
+
+private:
+    QList<QThread*> _threads;
+    QList<IoShard*> _shards;
+    int _nextShard;
+};
+
+}
+
+#endif // SOCKETSERVER_H
@@ -0,0 +1,163 @@
+#include "timingwheel.h"
+
+using namespace shiftnet;
+
+TimingWheel::TimingWheel(int resolution, QObject* parent)
+    : QObject(parent)
+    , _resolution(qMax(1, resolution))
+    , _lastTickCount(0)
+    , _advancing(false)
+    , _tick(0)
+    , _nextId(0)
+{
+    _timer.setInterval(_resolution);
+    _timer.setTimerType(Qt::PreciseTimer);
+    _timer.setSingleShot(false);
+    connect(&_timer, SIGNAL(timeout()), SLOT(advance()));
+}
+
+quint64 TimingWheel::schedule(int interval, const Callback& callback, bool repeat)
+{
+    // wheel kosong, mulai lagi dari tick 0 supaya tidak perlu mengejar tick yang terlewat.
+    // Selama advance() berjalan tick dan slot masih dipakai, jadi tidak di-reset.
+    if (_entries.isEmpty() && !_advancing) {
+        for (int level = 0; level < LevelCount; level++)
+            for (int slot = 0; slot < SlotCount; slot++)
+                _slots[level][slot].clear();
+
+        _tick = 0;
+        _clock.start();
+    }
+
+    if (!_timer.isActive())
+        _timer.start();
+
+    Entry entry;
+    entry.interval = qMax(1, (interval + _resolution - 1) / _resolution);
+    entry.deadline = _tick + entry.interval;
+    entry.repeat = repeat;
+    entry.callback = callback;
+
+    const quint64 id = ++_nextId;
+    _entries.insert(id, entry);
+    place(id, entry.deadline);
+
+    return id;
+}
+
+void TimingWheel::cancel(quint64 id)
+{
+    // id yang sudah dibatalkan dibiarkan di slot dan dilewati saat tick
+    _entries.remove(id);
+
+    if (_entries.isEmpty())
+        _timer.stop();
+}
+
+void TimingWheel::advance()
+{
+    const quint64 target = currentTick();
+    const qint64 lag = _clock.elapsed() - qint64(_tick + 1) * _resolution;
+    const int count = advanceTo(target);
+
+    if (count > 0)
+        emit ticked(count, qMax(Q_INT64_C(0), lag));
+}
+
+int TimingWheel::advanceBy(int ticks)
+{
+    return advanceTo(_tick + qMax(0, ticks));
+}
+
+int TimingWheel::advanceTo(quint64 target)
+{
+    int count = 0;
+
+    _advancing = true;
+    while (_tick < target) {
+        ++_tick;
+
+        if ((_tick & SlotMask) == 0)
+            cascade(1);
+
+        count += fire();
+    }
+    _advancing = false;
+
+    if (_entries.isEmpty())
+        _timer.stop();
+
+    _lastTickCount = count;
+    return count;
+}
+
+quint64 TimingWheel::currentTick() const
+{
+    return quint64(_clock.elapsed()) / _resolution;
+}
+
+void TimingWheel::place(quint64 id, quint64 deadline)
+{
+    // saat cascade, deadline tick ini masuk ke slot yang akan langsung di-fire
+    if (deadline < _tick)
+        deadline = _tick;
+
+    const quint64 delta = deadline - _tick;
+    int level = 0;
+    while (level < LevelCount - 1 && delta >= (Q_UINT64_C(1) << (SlotBits * (level + 1))))
+        level++;
+
+    _slots[level][(deadline >> (SlotBits * level)) & SlotMask].append(id);
+}
+
+void TimingWheel::cascade(int level)
+{
+    if (level >= LevelCount)
+        return;
+
+    const int index = (_tick >> (SlotBits * level)) & SlotMask;
+    if (index == 0)
+        cascade(level + 1);
+
+    QVector<quint64> ids;
+    ids.swap(_slots[level][index]);
+
+    for (quint64 id: ids) {
+        QHash<quint64, Entry>::const_iterator it = _entries.constFind(id);
+        if (it != _entries.constEnd())
+            place(id, it->deadline);
+    }
+}
+
+int TimingWheel::fire()
+{
+    QVector<quint64> ids;
+    ids.swap(_slots[0][_tick & SlotMask]);
+
+    int count = 0;
+    for (quint64 id: ids) {
+        QHash<quint64, Entry>::iterator it = _entries.find(id);
+        if (it == _entries.end())
+            continue;
+
+        if (it->deadline > _tick) {
+            place(id, it->deadline);
+            continue;
+        }
+
+        // callback boleh membatalkan atau menjadwalkan entry lain
+        const Callback callback = it->callback;
+        if (it->repeat) {
+            it->deadline += it->interval;
+            place(id, it->deadline);
+        }
+        else {
+            _entries.erase(it);
+        }
+
+        callback();
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,75 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+
+namespace shiftnet {
+
+// Timing wheel bertingkat, semua tenggat di server digerakkan satu timer.
+// Entry yang habis pada tick yang sama di-fire sekaligus.
+class TimingWheel : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void()> Callback;
+
+    explicit TimingWheel(int resolution = 1000, QObject* parent = 0);
+
+    quint64 schedule(int interval, const Callback& callback, bool repeat = false);
+    void cancel(quint64 id);
+
+    // maju sejumlah tick tanpa menunggu jam, mengembalikan jumlah entry yang di-fire
+    int advanceBy(int ticks);
+
+    inline int resolution() const { return _resolution; }
+    inline int count() const { return _entries.size(); }
+    inline int lastTickCount() const { return _lastTickCount; }
+
+signals:
+    void ticked(int count, qint64 lag);
+
+private slots:
+    void advance();
+
+private:
+    enum {
+        SlotBits   = 6,
+        SlotCount  = 1 << SlotBits,
+        SlotMask   = SlotCount - 1,
+        LevelCount = 4
+    };
+
+    struct Entry {
+        quint64 deadline;
+        quint64 interval;
+        bool repeat;
+        Callback callback;
+    };
+
+    int advanceTo(quint64 target);
+    quint64 currentTick() const;
+    void place(quint64 id, quint64 deadline);
+    void cascade(int level);
+    int fire();
+
+    QTimer _timer;
+    QElapsedTimer _clock;
+    int _resolution;
+    int _lastTickCount;
+    bool _advancing;
+    quint64 _tick;
+    quint64 _nextId;
+    QHash<quint64, Entry> _entries;
+    QVector<quint64> _slots[LevelCount][SlotCount];
+};
+
+}
+
+#endif // TIMINGWHEEL_H
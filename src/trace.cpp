@@ -0,0 +1,136 @@
+#include "trace.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+#include <QSaveFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCoreApplication>
+#include <QDebug>
+
+using namespace shiftnet;
+
+namespace {
+
+struct Span
+{
+    const char* name;
+    QString args;
+    qint64 start;
+    qint64 duration;
+    int thread;
+};
+
+QAtomicInt enabled(0);
+QAtomicInt lastThreadId(0);
+
+QMutex mutex;
+QVector<Span> spans;
+int capacity = 100000;
+int next = 0;
+
+QElapsedTimer startedTimer()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer;
+}
+
+const QElapsedTimer& clock()
+{
+    // inisialisasi static lokal aman terhadap thread, dimulai sekali
+    static const QElapsedTimer timer = startedTimer();
+    return timer;
+}
+
+int threadId()
+{
+    // id kecil per thread, lebih mudah dibaca di viewer daripada pointer thread
+    static thread_local int id = lastThreadId.fetchAndAddRelaxed(1) + 1;
+    return id;
+}
+
+}
+
+void Trace::setEnabled(bool value)
+{
+    clock();
+    enabled.store(value ? 1 : 0);
+}
+
+bool Trace::isEnabled()
+{
+    return enabled.load();
+}
+
+void Trace::setCapacity(int value)
+{
+    QMutexLocker locker(&mutex);
+    capacity = qMax(1, value);
+    spans.clear();
+    next = 0;
+}
+
+qint64 Trace::now()
+{
+    return clock().nsecsElapsed();
+}
+
+void Trace::record(const char* name, const QString& args, qint64 start, qint64 duration)
+{
+    const Span span = { name, args, start, duration, threadId() };
+
+    QMutexLocker locker(&mutex);
+    if (spans.size() < capacity)
+        spans.append(span);
+    else
+        spans[next] = span;
+    next = (next + 1) % capacity;
+}
+
+bool Trace::dump(const QString& fileName, int* count)
+{
+    QVector<Span> copy;
+    int first;
+    {
+        QMutexLocker locker(&mutex);
+        copy = spans;
+        first = copy.size() < capacity ? 0 : next;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray events;
+    for (int i = 0; i < copy.size(); i++) {
+        const Span& span = copy.at((first + i) % copy.size());
+        QJsonObject event({
+            { "name", QLatin1String(span.name) },
+            { "ph", "X" },
+            { "pid", pid },
+            { "tid", span.thread },
+            { "ts", span.start / 1000.0 },
+            { "dur", span.duration / 1000.0 },
+        });
+        if (!span.args.isEmpty())
+            event.insert("args", QJsonObject({{ "labels", span.args }}));
+        events.append(event);
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Trace dump failed:" << qPrintable(file.errorString());
+        return false;
+    }
+
+    file.write(QJsonDocument(QJsonObject({{ "traceEvents", events }})).toJson(QJsonDocument::Compact));
+    if (!file.commit()) {
+        qWarning() << "Trace dump failed:" << qPrintable(file.errorString());
+        return false;
+    }
+
+    if (count)
+        *count = events.size();
+    return true;
+}
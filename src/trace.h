@@ -0,0 +1,28 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+namespace shiftnet {
+
+// Span trace opsional di ring buffer, bisa disimpan dalam format Chrome trace
+// (chrome://tracing atau ui.perfetto.dev). Tidak mencatat apa pun selama
+// tracing tidak aktif.
+class Trace
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static void setCapacity(int capacity);
+
+    static qint64 now();
+    static void record(const char* name, const QString& args, qint64 start, qint64 duration);
+    static bool dump(const QString& fileName, int* count = 0);
+
+private:
+    Trace();
+};
+
+}
+
+#endif // TRACE_H
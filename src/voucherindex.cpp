@@ -0,0 +1,342 @@
+#include "voucherindex.h"
+#include "databaseexecutor.h"
+#include "database.h"
+
+#include <QSqlRecord>
+#include <QDateTime>
+#include <QPointer>
+#include <QStringList>
+
+#include <algorithm>
+
+using namespace shiftnet;
+
+VoucherIndex::VoucherIndex(DatabaseExecutor* executor, QObject* parent)
+    : QObject(parent)
+    , _executor(executor)
+    , _refreshing(false)
+    , _sweeping(false)
+    , _lastVoucherId(0)
+    , _hits(0)
+    , _misses(0)
+    , _unknownHits(0)
+    , _expiredCount(0)
+{
+    connect(&_refreshTimer, SIGNAL(timeout()), SLOT(refresh()));
+    connect(&_sweepTimer, SIGNAL(timeout()), SLOT(sweep()));
+}
+
+int VoucherIndex::load(const QList<QSqlRecord>& records, int* updated)
+{
+    int added = 0;
+    for (const QSqlRecord& record: records) {
+        const ActiveVoucher voucher = ActiveVoucher::fromRecord(record);
+        if (voucher.isNull())
+            continue;
+
+        _lastVoucherId = qMax(_lastVoucherId, voucher.id());
+
+        const QString code = key(voucher.code());
+        if (_touched.contains(code))
+            continue;
+
+        QHash<QString, ActiveVoucher>::const_iterator it = _vouchers.constFind(code);
+        if (it == _vouchers.constEnd()) {
+            insert(voucher);
+            added++;
+            continue;
+        }
+
+        // voucher yang sedang dipakai di server ini, data di memori lebih baru
+        if (it->activeClientId() || voucher.activeClientId())
+            continue;
+
+        // diubah di luar server ini, misalnya durasi atau tanggal kadaluarsa
+        if (it->id() != voucher.id() || it->remainingDuration() != voucher.remainingDuration()
+                || it->expirationDateTime() != voucher.expirationDateTime()) {
+            remove(code);
+            insert(voucher);
+            if (updated)
+                (*updated)++;
+        }
+    }
+
+    return added;
+}
+
+void VoucherIndex::find(const QString& voucherCode, QObject* context, const Callback& callback)
+{
+    const QString code = key(voucherCode);
+    QHash<QString, ActiveVoucher>::const_iterator it = _vouchers.constFind(code);
+    if (it != _vouchers.constEnd()) {
+        _hits++;
+        callback(it.value());
+        return;
+    }
+
+    if (_unknownCodes.value(code) > QDateTime::currentMSecsSinceEpoch()) {
+        _unknownHits++;
+        callback(ActiveVoucher());
+        return;
+    }
+
+    _misses++;
+
+    QPointer<QObject> guard(context);
+    _executor->findVoucher(voucherCode, this, [this, code, guard, callback](const QSqlRecord& record) {
+        const ActiveVoucher voucher = ActiveVoucher::fromRecord(record);
+        if (voucher.isNull())
+            rememberUnknown(code);
+        else if (!_vouchers.contains(code)) {
+            touch(code);
+            insert(voucher);
+        }
+
+        if (guard)
+            callback(voucher);
+    });
+}
+
+void VoucherIndex::setUsed(const QString& voucherCode, int clientId, const QString& username)
+{
+    const QString code = key(voucherCode);
+    QHash<QString, ActiveVoucher>::iterator it = _vouchers.find(code);
+    if (it == _vouchers.end())
+        return;
+
+    touch(code);
+
+    if (it->activeClientId())
+        _codesByClientIds[it->activeClientId()].remove(code);
+
+    it->setActiveClientId(clientId);
+    it->setLastActiveUsername(username);
+    _codesByClientIds[clientId].insert(code);
+}
+
+void VoucherIndex::setDuration(const QString& voucherCode, int duration)
+{
+    const QString code = key(voucherCode);
+    QHash<QString, ActiveVoucher>::iterator it = _vouchers.find(code);
+    if (it != _vouchers.end()) {
+        touch(code);
+        it->setRemainingDuration(duration);
+    }
+}
+
+QSet<QString> VoucherIndex::releaseClient(int clientId)
+{
+    const QSet<QString> codes = _codesByClientIds.take(clientId);
+    for (const QString& code: codes) {
+        QHash<QString, ActiveVoucher>::iterator it = _vouchers.find(code);
+        if (it != _vouchers.end()) {
+            touch(code);
+            it->setActiveClientId(0);
+        }
+    }
+
+    return codes;
+}
+
+void VoucherIndex::release(const QString& voucherCode, int clientId)
+{
+    // hanya jika voucher masih tercatat dipakai PC tersebut
+    const QString code = key(voucherCode);
+    QHash<QString, ActiveVoucher>::iterator it = _vouchers.find(code);
+    if (it == _vouchers.end() || it->activeClientId() != clientId)
+        return;
+
+    touch(code);
+    it->setActiveClientId(0);
+
+    QHash<int, QSet<QString> >::iterator codes = _codesByClientIds.find(clientId);
+    if (codes != _codesByClientIds.end()) {
+        codes->remove(code);
+        if (codes->isEmpty())
+            _codesByClientIds.erase(codes);
+    }
+}
+
+void VoucherIndex::remove(const QString& voucherCode)
+{
+    const QString code = key(voucherCode);
+    touch(code);
+
+    const ActiveVoucher voucher = _vouchers.take(code);
+    if (voucher.activeClientId()) {
+        QHash<int, QSet<QString> >::iterator it = _codesByClientIds.find(voucher.activeClientId());
+        if (it != _codesByClientIds.end()) {
+            it->remove(code);
+            if (it->isEmpty())
+                _codesByClientIds.erase(it);
+        }
+    }
+}
+
+void VoucherIndex::setRefreshInterval(int msec)
+{
+    if (msec <= 0) {
+        _refreshTimer.stop();
+        return;
+    }
+
+    _refreshTimer.start(msec);
+}
+
+void VoucherIndex::setSweepInterval(int msec)
+{
+    if (msec <= 0) {
+        _sweepTimer.stop();
+        return;
+    }
+
+    _sweepTimer.start(msec);
+}
+
+double VoucherIndex::hitRate() const
+{
+    const quint64 total = _hits + _misses + _unknownHits;
+    return total ? double(_hits + _unknownHits) / total : 0;
+}
+
+void VoucherIndex::refresh()
+{
+    if (_refreshing)
+        return;
+
+    // satu putaran penuh per halaman: voucher baru ditambahkan, baris yang
+    // diubah di luar server ini diperbarui
+    _refreshing = true;
+    _touched.clear();
+    refreshPage(0, 0, 0);
+}
+
+void VoucherIndex::refreshPage(quint64 afterVoucherId, int added, int updated)
+{
+    _executor->post([afterVoucherId]() { return Database::activeVouchers(afterVoucherId, PageSize); },
+                    this, [this, added, updated](const QList<QSqlRecord>& records) {
+        int pageUpdated = 0;
+        const int pageAdded = load(records, &pageUpdated);
+
+        if (records.size() == PageSize) {
+            refreshPage(ActiveVoucher::fromRecord(records.last()).id(), added + pageAdded, updated + pageUpdated);
+            return;
+        }
+
+        _refreshing = false;
+        _touched.clear();
+
+        // kode yang tadinya tidak dikenal mungkin baru saja dibuat
+        if (added + pageAdded > 0 || updated + pageUpdated > 0)
+            _unknownCodes.clear();
+    });
+}
+
+void VoucherIndex::sweep()
+{
+    if (_sweeping)
+        return;
+
+    // voucher yang habis dipakai meninggalkan entry basi sampai tanggal kadaluarsanya
+    if (_expirations.size() > 2 * _vouchers.size() + SweepBatchSize) {
+        _expirations.clear();
+        for (const ActiveVoucher& voucher: _vouchers)
+            if (voucher.expirationDateTime().isValid())
+                pushExpiration(voucher.expirationDateTime().toMSecsSinceEpoch(), voucher.id(), key(voucher.code()));
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QList<quint64> voucherIds;
+    QStringList codes;
+    QList<Expiration> inUse;
+
+    while (!_expirations.isEmpty() && _expirations.first().dateTime <= now && voucherIds.size() < SweepBatchSize) {
+        std::pop_heap(_expirations.begin(), _expirations.end());
+        const Expiration expiration = _expirations.takeLast();
+
+        // entry basi, voucher sudah dihapus, diganti atau tanggal kadaluarsanya diperpanjang
+        QHash<QString, ActiveVoucher>::const_iterator it = _vouchers.constFind(expiration.code);
+        if (it == _vouchers.constEnd() || it->id() != expiration.voucherId
+                || it->expirationDateTime().toMSecsSinceEpoch() > now)
+            continue;
+
+        // sesi yang sedang berjalan tidak diputus, dicek lagi di sweep berikutnya
+        if (it->activeClientId()) {
+            inUse << expiration;
+            continue;
+        }
+
+        voucherIds << expiration.voucherId;
+        codes << expiration.code;
+    }
+
+    for (const Expiration& expiration: inUse)
+        pushExpiration(now + _sweepTimer.interval(), expiration.voucherId, expiration.code);
+
+    if (voucherIds.isEmpty())
+        return;
+
+    // dikeluarkan dari indeks lebih dulu supaya tidak dipakai selagi dihapus
+    for (const QString& code: codes)
+        remove(code);
+
+    _sweeping = true;
+    _executor->post([voucherIds]() { return Database::deleteExpiredVouchers(voucherIds); },
+                    this, [this, codes](int deleted) {
+        _sweeping = false;
+        if (deleted < 0)
+            return;
+
+        _expiredCount += deleted;
+        if (codes.size() == SweepBatchSize)
+            sweep();
+    });
+}
+
+void VoucherIndex::touch(const QString& code)
+{
+    if (_refreshing)
+        _touched.insert(code);
+}
+
+void VoucherIndex::insert(const ActiveVoucher& voucher)
+{
+    const QString code = key(voucher.code());
+    _vouchers.insert(code, voucher);
+    _unknownCodes.remove(code);
+
+    if (voucher.expirationDateTime().isValid())
+        pushExpiration(voucher.expirationDateTime().toMSecsSinceEpoch(), voucher.id(), code);
+
+    if (voucher.activeClientId())
+        _codesByClientIds[voucher.activeClientId()].insert(code);
+}
+
+void VoucherIndex::pushExpiration(qint64 dateTime, quint64 voucherId, const QString& code)
+{
+    Expiration expiration;
+    expiration.dateTime = dateTime;
+    expiration.voucherId = voucherId;
+    expiration.code = code;
+    _expirations.append(expiration);
+    std::push_heap(_expirations.begin(), _expirations.end());
+}
+
+void VoucherIndex::rememberUnknown(const QString& code)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    if (_unknownCodes.size() >= UnknownCodeCapacity) {
+        for (QHash<QString, qint64>::iterator it = _unknownCodes.begin(); it != _unknownCodes.end(); ) {
+            if (it.value() <= now)
+                it = _unknownCodes.erase(it);
+            else
+                ++it;
+        }
+
+        if (_unknownCodes.size() >= UnknownCodeCapacity)
+            _unknownCodes.clear();
+    }
+
+    _unknownCodes.insert(code, now + UnknownCodeTtl);
+}
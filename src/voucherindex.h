@@ -0,0 +1,106 @@
+#ifndef VOUCHERINDEX_H
+#define VOUCHERINDEX_H
+
+#include <QObject>
+#include <QTimer>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include <functional>
+
+#include "activevoucher.h"
+
+class QSqlRecord;
+
+namespace shiftnet {
+
+class DatabaseExecutor;
+
+// Salinan shiftnet_active_vouchers di memori supaya validasi voucher tidak
+// perlu query. Kode yang tidak ada di indeks dicari ke database, kode yang
+// tidak ditemukan diingat sebentar supaya tebakan berulang tidak membebani DB.
+// Voucher yang kadaluarsa dihapus bertahap berdasarkan min-heap tanggal kadaluarsa.
+// Kode voucher tidak membedakan huruf besar/kecil, sama seperti di database.
+class VoucherIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    typedef std::function<void(const ActiveVoucher&)> Callback;
+
+    enum {
+        PageSize = 1000,
+        UnknownCodeCapacity = 1000,
+        UnknownCodeTtl = 10000,
+        SweepBatchSize = 500
+    };
+
+    explicit VoucherIndex(DatabaseExecutor* executor, QObject* parent = 0);
+
+    int load(const QList<QSqlRecord>& records, int* updated = 0);
+    void find(const QString& code, QObject* context, const Callback& callback);
+
+    void setUsed(const QString& code, int clientId, const QString& username);
+    void setDuration(const QString& code, int duration);
+    // kode voucher yang dilepas
+    QSet<QString> releaseClient(int clientId);
+    void release(const QString& code, int clientId);
+    void remove(const QString& code);
+
+    void setRefreshInterval(int msec);
+    void setSweepInterval(int msec);
+
+    inline int count() const { return _vouchers.size(); }
+    inline quint64 lastVoucherId() const { return _lastVoucherId; }
+    inline quint64 hits() const { return _hits; }
+    inline quint64 misses() const { return _misses; }
+    inline quint64 unknownHits() const { return _unknownHits; }
+    inline quint64 expiredCount() const { return _expiredCount; }
+    double hitRate() const;
+
+public slots:
+    void refresh();
+    void sweep();
+
+private:
+    struct Expiration {
+        qint64 dateTime;
+        quint64 voucherId;
+        QString code;
+
+        // std::push_heap membuat max-heap, dibalik supaya yang paling awal di atas
+        inline bool operator<(const Expiration& other) const { return dateTime > other.dateTime; }
+    };
+
+    static inline QString key(const QString& code) { return code.toUpper(); }
+
+    void refreshPage(quint64 afterVoucherId, int added, int updated);
+    void touch(const QString& code);
+    void insert(const ActiveVoucher& voucher);
+    void pushExpiration(qint64 dateTime, quint64 voucherId, const QString& code);
+    void rememberUnknown(const QString& code);
+
+    DatabaseExecutor* _executor;
+    QTimer _refreshTimer;
+    QTimer _sweepTimer;
+    bool _refreshing;
+    bool _sweeping;
+    quint64 _lastVoucherId;
+
+    QHash<QString, ActiveVoucher> _vouchers;
+    QHash<int, QSet<QString> > _codesByClientIds;
+    QHash<QString, qint64> _unknownCodes;
+    // kode yang berubah di memori selama refresh berjalan, hasil query untuknya sudah basi
+    QSet<QString> _touched;
+    QVector<Expiration> _expirations;
+
+    quint64 _hits;
+    quint64 _misses;
+    quint64 _unknownHits;
+    quint64 _expiredCount;
+};
+
+}
+
+#endif // VOUCHERINDEX_H
@@ -1,5 +1,6 @@
 #include "vouchervalidator.h"
 #include "database.h"
+#include "activevoucher.h"
 #include <QSqlRecord>
 #include <QDateTime>
 #include <QVariant>
@@ -8,37 +9,46 @@ using namespace shiftnet;
 
 bool VoucherValidator::isValid(const QString& code, bool checkUsedVoucher)
 {
-    QSqlRecord record = Database::findVoucher(code);
-    if (record.isEmpty()) {
+    return isValid(Database::findVoucher(code), checkUsedVoucher);
+}
+
+bool VoucherValidator::isValid(const QSqlRecord& record, bool checkUsedVoucher)
+{
+    return isValid(ActiveVoucher::fromRecord(record), checkUsedVoucher);
+}
+
+bool VoucherValidator::isValid(const ActiveVoucher& voucher, bool checkUsedVoucher)
+{
+    if (voucher.isNull()) {
         _error = "Voucher tidak ditemukan";
         return false;
     }
 
     const QDateTime now = QDateTime::currentDateTime();
-    const QDateTime expirationDateTime = record.value("expirationDateTime").toDateTime();
+    const QDateTime expirationDateTime = voucher.expirationDateTime();
     if (expirationDateTime < now) {
         _error = "Voucher sudah kadaluarsa sejak " + expirationDateTime.toString("dddd, dd MMMM yyyy hh:mm:ss") + ".";
         return false;
     }
 
-    if (checkUsedVoucher && !record.value("lastActiveUsername").toString().isEmpty()) {
+    if (checkUsedVoucher && !voucher.lastActiveUsername().isEmpty()) {
         _error = "Kode voucher bekas tidak dapat dipakai.";
         return false;
     }
 
-    int activeClientId = record.value("activeClientId").toInt();
+    int activeClientId = voucher.activeClientId();
     if (activeClientId) {
         _error = "Voucher sedang digunakan di Client " + QString::number(activeClientId) + ".";
         return false;
     }
 
-    int duration = record.value("remainingDuration").toInt();
+    int duration = voucher.remainingDuration();
     if (duration <= 0) {
         _error = "Sisa waktu telah habis.";
         return false;
     }
 
-    _voucher = Voucher(record.value("code").toString(), record.value("remainingDuration").toInt(), record.value("id").value<quint64>());
+    _voucher = voucher.toVoucher();
 
     return true;
 }
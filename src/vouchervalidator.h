@@ -3,13 +3,19 @@
 
 #include "voucher.h"
 
+class QSqlRecord;
+
 namespace shiftnet {
 
+class ActiveVoucher;
+
 class VoucherValidator
 {
 public:
     inline VoucherValidator() {}
     bool isValid(const QString& code, bool checkUsedVoucher);
+    bool isValid(const QSqlRecord& record, bool checkUsedVoucher);
+    bool isValid(const ActiveVoucher& voucher, bool checkUsedVoucher);
     inline QString error() const { return _error; }
     inline Voucher voucher() const { return _voucher; }
 
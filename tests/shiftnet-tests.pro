@@ -0,0 +1,12 @@
+TARGET = shiftnet-tests
+TEMPLATE = app
+DESTDIR = $$PWD/../dist
+QT = core testlib
+CONFIG += console testcase
+INCLUDEPATH += $$PWD/../src
+SOURCES += \
+    timingwheeltest.cpp \
+    ../src/timingwheel.cpp
+
+HEADERS  += \
+    ../src/timingwheel.h
@@ -0,0 +1,177 @@
+#include "timingwheel.h"
+
+#include <QtTest>
+
+namespace shiftnet {
+
+// Resolusi 1 ms supaya interval sama dengan jumlah tick. Jam tidak dipakai,
+// wheel hanya dimajukan lewat advanceBy.
+class TimingWheelTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fireAtDeadline_data();
+    void fireAtDeadline();
+    void fireAfterOffset_data();
+    void fireAfterOffset();
+    void repeat();
+    void cancel();
+    void scheduleDuringAdvance();
+    void resetDuringAdvance();
+    void resetWhenEmpty();
+};
+
+}
+
+using namespace shiftnet;
+
+void TimingWheelTest::fireAtDeadline_data()
+{
+    QTest::addColumn<int>("interval");
+
+    // batas level: 64, 64^2 dan 64^3 tick
+    QTest::newRow("1") << 1;
+    QTest::newRow("63") << 63;
+    QTest::newRow("64") << 64;
+    QTest::newRow("65") << 65;
+    QTest::newRow("4095") << 4095;
+    QTest::newRow("4096") << 4096;
+    QTest::newRow("4097") << 4097;
+    QTest::newRow("262143") << 262143;
+    QTest::newRow("262144") << 262144;
+    QTest::newRow("262145") << 262145;
+}
+
+void TimingWheelTest::fireAtDeadline()
+{
+    QFETCH(int, interval);
+
+    TimingWheel wheel(1);
+    int fired = 0;
+    wheel.schedule(interval, [&fired]() { fired++; });
+
+    QCOMPARE(wheel.advanceBy(interval - 1), 0);
+    QCOMPARE(fired, 0);
+    QCOMPARE(wheel.advanceBy(1), 1);
+    QCOMPARE(fired, 1);
+    QCOMPARE(wheel.count(), 0);
+}
+
+void TimingWheelTest::fireAfterOffset_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<int>("interval");
+
+    // deadline yang melewati batas slot level di atasnya
+    QTest::newRow("level0 wrap") << 60 << 10;
+    QTest::newRow("level1 boundary") << 63 << 1;
+    QTest::newRow("level1 cascade") << 100 << 4000;
+    QTest::newRow("level2 boundary") << 4090 << 10;
+    QTest::newRow("level2 cascade") << 4000 << 70000;
+    QTest::newRow("level3 boundary") << 262140 << 10;
+}
+
+void TimingWheelTest::fireAfterOffset()
+{
+    QFETCH(int, offset);
+    QFETCH(int, interval);
+
+    // entry panjang menjaga wheel tetap berisi supaya tick tidak di-reset
+    TimingWheel wheel(1);
+    int fired = 0;
+    wheel.schedule(1 << 23, []() {});
+    QCOMPARE(wheel.advanceBy(offset), 0);
+
+    wheel.schedule(interval, [&fired]() { fired++; });
+    QCOMPARE(wheel.advanceBy(interval - 1), 0);
+    QCOMPARE(wheel.advanceBy(1), 1);
+    QCOMPARE(fired, 1);
+    QCOMPARE(wheel.count(), 1);
+}
+
+void TimingWheelTest::repeat()
+{
+    TimingWheel wheel(1);
+    int fired = 0;
+    const quint64 id = wheel.schedule(64, [&fired]() { fired++; }, true);
+
+    QCOMPARE(wheel.advanceBy(64 * 5), 5);
+    QCOMPARE(fired, 5);
+    QCOMPARE(wheel.advanceBy(63), 0);
+
+    wheel.cancel(id);
+    QCOMPARE(wheel.advanceBy(64 * 2), 0);
+    QCOMPARE(wheel.count(), 0);
+}
+
+void TimingWheelTest::cancel()
+{
+    TimingWheel wheel(1);
+    int fired = 0;
+    const quint64 id = wheel.schedule(5000, [&fired]() { fired++; });
+    wheel.schedule(5000, [&fired]() { fired += 10; });
+
+    // sudah turun dari level 2 ke level 0 saat dibatalkan
+    QCOMPARE(wheel.advanceBy(4990), 0);
+    wheel.cancel(id);
+    QCOMPARE(wheel.advanceBy(10), 1);
+    QCOMPARE(fired, 10);
+}
+
+void TimingWheelTest::scheduleDuringAdvance()
+{
+    TimingWheel wheel(1);
+    int fired = 0;
+
+    // entry baru dari callback ikut di-fire dalam advance yang sama
+    wheel.schedule(1, [&wheel, &fired]() {
+        fired++;
+        wheel.schedule(70, [&fired]() { fired++; });
+    });
+
+    QCOMPARE(wheel.advanceBy(71), 2);
+    QCOMPARE(fired, 2);
+    QCOMPARE(wheel.count(), 0);
+}
+
+void TimingWheelTest::resetDuringAdvance()
+{
+    TimingWheel wheel(1);
+    int fired = 0;
+
+    // callback memakai entry terakhir, wheel kosong saat schedule dipanggil.
+    // Tick dan slot tidak boleh di-reset selama advance masih berjalan.
+    wheel.schedule(100, [&wheel, &fired]() {
+        fired++;
+        wheel.schedule(4000, [&fired]() { fired++; });
+    });
+
+    QCOMPARE(wheel.advanceBy(100), 1);
+    QCOMPARE(wheel.count(), 1);
+    QCOMPARE(wheel.advanceBy(3999), 0);
+    QCOMPARE(wheel.advanceBy(1), 1);
+    QCOMPARE(fired, 2);
+}
+
+void TimingWheelTest::resetWhenEmpty()
+{
+    TimingWheel wheel(1);
+    int fired = 0;
+
+    wheel.schedule(10, [&fired]() { fired++; });
+    QCOMPARE(wheel.advanceBy(10), 1);
+    QCOMPARE(wheel.count(), 0);
+
+    // wheel kosong di luar advance, mulai lagi dari tick 0
+    const quint64 id = wheel.schedule(100, [&fired]() { fired++; });
+    wheel.cancel(id);
+    wheel.schedule(64, [&fired]() { fired++; });
+    QCOMPARE(wheel.advanceBy(63), 0);
+    QCOMPARE(wheel.advanceBy(1), 1);
+    QCOMPARE(fired, 2);
+}
+
+QTEST_GUILESS_MAIN(TimingWheelTest)
+
+#include "timingwheeltest.moc"